@@ -0,0 +1,128 @@
+/*
+ * =============================================================
+ * 行動紀錄 (Append-only Action Log)
+ * -------------------------------------------------------------
+ * 以精簡二進位格式記錄引擎的所有外部輸入，供事後在開發機重播：
+ *   - LOG_COMMAND：遊戲工作處理的每個玩家指令 (座位已登錄者只記座位)
+ *   - LOG_LOOP   ：loop() 中實際發生的轉移 (到期計時器、語音播完/開播、搖桿)
+ *   - LOG_SEED   ：setupRoles() 洗牌所用的亂數種子
+ *   - LOG_STATE  ：每次同步後的狀態指紋，重播時用來比對
+ *   - LOG_RESUME ：開機時由快照接續一局 (之前的輸入不在本紀錄內)
+ *   - LOG_CHECKPOINT：開局與接續後的完整引擎狀態 (快照、座位、連線、計時器與語音)，
+ *                   分段寫入；紀錄繞回或由快照接續時，重播從仍完整的檢查點開始
+ * 紀錄存放於固定容量環狀緩衝，滿了丟棄最舊的紀錄。
+ * 寫入只在遊戲工作；匯出 (HTTP) 可由任何工作呼叫，以互斥鎖保護。
+ *
+ * 匯出格式 (little-endian)：
+ *   header  "WWLG" | u8 版本 | u24 紀錄區長度 (0 = 未記錄) | u32 已丟棄紀錄數 | u32 第一筆紀錄的時間 (ms)
+ *   匯出途中紀錄區被新紀錄覆蓋時內容提早結束，讀取端依紀錄區長度判定為不完整
+ *   record  u8 長度 (不含本身) | u8 種類 | zigzag varint 與前一筆的時間差 | 內容
+ * =============================================================
+ */
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "protocol.h"
+
+#ifndef ACTION_LOG_BYTES
+#define ACTION_LOG_BYTES 32768
+#endif
+static_assert(ACTION_LOG_BYTES < (1 << 24), "export header stores the body length in 24 bits");
+
+enum LogRecord : uint8_t {
+    LOG_COMMAND = 1,    // varint clientId | u8 動作 | u8 旗標 | 裝置 | 目標
+    LOG_LOOP,           // u8 到期計時器遮罩 | u8 LoopFlag
+    LOG_SEED,           // varint 種子
+    LOG_STATE,          // u32 狀態指紋
+    LOG_RESUME,         // u32 快照內容 CRC
+    LOG_CHECKPOINT,     // u8 段號 | u8 段數 | 內容 (由 WerewolfGame 編碼)
+};
+
+// LOG_COMMAND 旗標
+enum : uint8_t { CMD_BINARY = 1, CMD_WANTS_MSGPACK = 2 };
+
+// LOG_COMMAND 的 ID 欄位：0 = 空字串，1..CAPACITY = 座位 + 1，ID_LITERAL 之後接長度與字串
+static const uint8_t ID_LITERAL = 0xFF;
+
+// LOG_LOOP：該次 loop() 觀察到的外部事件
+enum LoopFlag : uint8_t {
+    LOOP_CUE_DONE    = 1,   // 目前語音播完 (BUSY 轉閒或逾時)
+    LOOP_CUE_STARTED = 2,   // 開始播放下一段語音
+    LOOP_AXIS_UP     = 4,   // 搖桿右推
+    LOOP_AXIS_DOWN   = 8,   // 搖桿左推
+    LOOP_BUTTON      = 16,  // 按鍵 (確認人數或同意續局)
+    LOOP_SETUP       = 32,  // 人數到齊，分配角色並開始倒數
+};
+
+class ActionLog {
+public:
+    static const size_t CAPACITY = ACTION_LOG_BYTES;
+    static const size_t HEADER_LEN = 16;
+    static const uint8_t VERSION = 2;                // 2：新增 LOG_CHECKPOINT (仍可讀 1)
+    static const size_t CHECKPOINT_CHUNK = 240;      // 每段內容上限 (紀錄長度以 u8 表示)
+
+    // --- 寫入 (僅限遊戲工作) ---
+    void command(unsigned long now, const Command& cmd, int devSeat, int targetSeat);
+    void loop(unsigned long now, uint8_t timers, uint8_t flags);
+    void seed(unsigned long now, uint32_t seed);
+    void state(unsigned long now, uint32_t digest);
+    void resume(unsigned long now, uint32_t snapshotCrc);
+    void checkpoint(unsigned long now, const uint8_t* data, size_t len);
+    void setEnabled(bool on) { enabled = on; }   // false：不寫入也不取鎖 (模擬器)
+    bool isEnabled() const { return enabled; }
+
+    // --- 匯出 (任何工作) ---
+    // 匯出範圍於 beginExport() 時固定；之後寫入的紀錄不含在內
+    struct Export {
+        uint8_t header[HEADER_LEN];
+        uint32_t from, to;                   // 絕對位置
+    };
+    size_t beginExport(Export& e);           // 回傳總長度 (含 header)
+    // 讀取匯出內容的 [offset, offset + len)；該段已被新紀錄覆蓋時回傳 0
+    size_t exportRead(const Export& e, size_t offset, uint8_t* dst, size_t len);
+    void dump(std::string& out);             // 一次匯出全部 (開發機)
+
+    uint32_t records = 0, dropped = 0;
+
+private:
+    void append(uint8_t type, unsigned long now, const uint8_t* payload, size_t len);
+
+    std::mutex lock;
+    bool enabled = true;
+    uint8_t buf[CAPACITY];
+    uint32_t head = 0, tail = 0;             // 絕對位置 (寫入總量)，索引為 pos % CAPACITY
+    uint32_t tailTime = 0;                   // 最舊一筆紀錄的時間
+    uint32_t lastTime = 0;
+};
+
+// --- 解碼 (重播工具) ---
+struct LogEntry {
+    uint8_t type = 0;
+    uint32_t time = 0;                       // 絕對時間 (ms)
+    const uint8_t* payload = nullptr;
+    size_t len = 0;
+};
+
+class LogReader {
+public:
+    // 驗證 header；格式不符或內容不完整 (truncated) 回傳 false
+    bool open(const uint8_t* data, size_t len);
+    bool next(LogEntry& e);
+    uint32_t dropped = 0;
+    uint32_t expected = 0;                   // header 記錄的紀錄區長度 (0 = 未記錄)
+    bool truncated = false;
+
+    // 內容欄位解碼
+    static bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v);
+    // LOG_COMMAND 的 ID 欄位：seat 為座位 (-1 = 字串或空)，literal 為字串內容
+    static bool readId(const uint8_t*& p, const uint8_t* end, int& seat, char* literal);
+
+private:
+    const uint8_t* p = nullptr;
+    const uint8_t* end = nullptr;
+    uint32_t time = 0;
+    bool first = true;
+};
@@ -0,0 +1,61 @@
+/*
+ * =============================================================
+ * 語音佇列 (Non-blocking Audio Cue Queue)
+ * -------------------------------------------------------------
+ * 取代 playVoice() 的 delay(50) 與等待 DF_BUSY_PIN 的忙等迴圈：
+ *   - 音檔依序排入固定容量環狀佇列，一段播完 (BUSY 由忙轉閒) 或逾時才播下一段
+ *   - 每段可附帶「播完後的狀態轉移」代碼，由 poll() 回報給引擎執行
+ *   - 佇列已滿時，附帶轉移的語音擠掉最舊的一般語音，轉移不會因此遺失
+ * poll() 每次主迴圈呼叫一次，從不阻塞，網路與 DNS 處理不再被音效卡住。
+ * =============================================================
+ */
+#pragma once
+
+#include "hal.h"
+
+struct AudioCue {
+    int track = 0;                   // DFPlayer 音檔編號
+    unsigned long timeoutMs = 0;     // BUSY 未轉閒時的最長等待
+    int followUp = 0;                // 播完後的狀態轉移 (0 = 無)
+    int arg = 0;                     // 狀態轉移參數
+};
+
+class AudioQueue {
+public:
+    static const int CAPACITY = 8;
+    static const unsigned long SETTLE_MS = 50;          // DFPlayer 指令穩定時間，之後才讀 BUSY
+    static const unsigned long DEFAULT_TIMEOUT_MS = 5000;
+
+    AudioQueue(AudioOut& out, Clock& clock) : out(out), clock(clock) {}
+
+    // 排入一段語音；佇列已滿時回傳 false (附帶轉移者先擠掉最舊的一般語音，全是轉移才失敗)
+    bool push(int track, unsigned long timeoutMs = DEFAULT_TIMEOUT_MS, int followUp = 0, int arg = 0);
+    // 推進播放；有附帶狀態轉移的語音播完時回傳 true 並填入 done
+    bool poll(AudioCue& done);
+    // 清空待播語音並取消所有狀態轉移 (目前這段仍會播完)
+    void clear();
+    bool idle() const { return !playing && size == 0; }
+    // 距下次需要 poll() 的毫秒數 (NO_POLL = 佇列閒置)
+    unsigned long nextPollIn(unsigned long now, unsigned long pollMs) const;
+    static const unsigned long NO_POLL = (unsigned long)-1;
+
+    // 行動紀錄檢查點：播放中的一段與待播語音 (依播放順序)
+    bool playingCue(AudioCue& cue, unsigned long& since) const { cue = current; since = startedAt; return playing; }
+    int pending() const { return size; }
+    const AudioCue& pendingAt(int i) const { return cues[(head + i) % CAPACITY]; }
+    void restore(bool isPlaying, const AudioCue& cue, unsigned long since, const AudioCue* queued, int n);
+
+    unsigned long played = 0, finished = 0, timeouts = 0, dropped = 0;
+
+private:
+    AudioOut& out;
+    Clock& clock;
+    AudioCue cues[CAPACITY];
+    int head = 0, size = 0;
+    AudioCue current;
+    bool playing = false;
+    bool waiting = false;            // 有待播語音但喇叭尚未輪到本桌
+    unsigned long startedAt = 0;
+
+    bool evictPlain();
+};
@@ -0,0 +1,46 @@
+/*
+ * =============================================================
+ * 強制門戶 (Captive Portal)
+ * -------------------------------------------------------------
+ * 手機連上 softAP 後會先以固定網址檢查能否上網；回應越快，
+ * 「登入網路」視窗越早出現，玩家越快進入遊戲：
+ *   - 各系統的偵測網址預先列表，回應固定 (重新導向或直接回傳引導頁)
+ *   - 引導頁為靜態字串 (存於 flash)，不需組字串或配置記憶體
+ *   - DNS：所有 A 查詢都回答本機位址，AAAA 回答「無紀錄」讓手機立即改用 IPv4
+ * 登入視窗的瀏覽器與一般瀏覽器不共用 localStorage (deviceId)，
+ * 因此引導頁請玩家改用瀏覽器開啟遊戲，重新整理後才能保留座位。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CAPTIVE_ORIGIN
+#define CAPTIVE_ORIGIN "http://192.168.4.1"
+#endif
+
+// --- 偵測網址 ---
+enum CaptiveReply : uint8_t {
+    CAPTIVE_REDIRECT,    // 302 導向引導頁 (Android、Windows、Firefox...)
+    CAPTIVE_LANDING,     // 直接回傳引導頁 (Apple：內容不是 "Success" 即開啟登入視窗，省一次往返)
+};
+
+struct CaptiveProbe {
+    const char* path;    // 不含 query
+    CaptiveReply reply;
+    const char* os;
+};
+
+extern const CaptiveProbe CAPTIVE_PROBES[];
+extern const int CAPTIVE_PROBE_COUNT;
+
+// --- 引導頁 ---
+#define CAPTIVE_LANDING_PATH "/portal"
+#define CAPTIVE_LANDING_URL CAPTIVE_ORIGIN CAPTIVE_LANDING_PATH
+extern const char CAPTIVE_LANDING_HTML[];
+extern const size_t CAPTIVE_LANDING_LEN;
+
+// --- DNS ---
+// 依查詢組出回應 (一律指向 ip)；不是標準查詢或格式錯誤回傳 0 (不回應)
+size_t dnsReply(const uint8_t* query, size_t len, const uint8_t ip[4], uint8_t* out, size_t cap);
@@ -0,0 +1,231 @@
+/*
+ * =============================================================
+ * 狼人殺遊戲引擎 (規則與階段流程)
+ * -------------------------------------------------------------
+ * 原本散落在 main.cpp 的全域狀態與 syncGameState()/onWsEvent()/loop()
+ * 邏輯集中於此，所有硬體操作經由 Hal 介面，可在 ESP32 與 Linux 上執行。
+ * =============================================================
+ */
+#pragma once
+
+#include <map>
+#include <string>
+#include <ArduinoJson.h>
+#include "hal.h"
+#include "action_log.h"
+#include "audio_queue.h"
+#include "oled_renderer.h"
+#include "timer_set.h"
+#include "metrics.h"
+#include "player_table.h"
+#include "protocol.h"
+#include "role_pool.h"
+#include "role_traits.h"
+#include "snapshot.h"
+#include "vote_box.h"
+
+class WerewolfGame {
+public:
+    explicit WerewolfGame(Hal& hal);
+
+    void begin();                                                    // 開機初始化顯示；有快照則接續該局
+    bool restoreCheckpoint(const uint8_t* data, size_t len);         // 重播：由行動紀錄的檢查點接續 (取代 begin())
+    void onMessage(uint32_t clientId, const char* data, size_t len, bool binary); // 解析並立即處理 (單執行緒)
+    void handleCommand(const Command& cmd);                          // 處理已解析的指令 (僅限遊戲工作)
+    unsigned long loop();                                            // 主迴圈單次處理，回傳距下次需呼叫的毫秒數
+    unsigned long nextWakeMs();
+    OledRenderer& oled() { return oledRenderer; }                   // 由繪製工作呼叫 render()
+    Metrics& metrics() { return stats; }                             // read() 可由任何工作呼叫
+    ActionLog& actionLog() { return journal; }                       // 匯出可由任何工作呼叫
+    uint32_t stateDigest() const;                                    // 規則狀態指紋 (重播比對用)
+    void setRolePool(const RolePool& pool) { rolePool = pool; }      // 下次分配角色時生效
+    void setVoteRules(VoteKind kind, const VoteRules& rules) { voteRules[kind] = rules; } // 下次開票時生效
+    void setMetricsPeriod(unsigned long ms) { metricsPeriodMs = ms; } // 0 = 停止整理指標快照 (模擬器)
+    void setJournaling(bool on) { journal.setEnabled(on); }          // false = 不寫行動紀錄 (模擬器)
+    void setRoom(int number, int count) { roomNumber = number; roomCount = count; } // 多桌時顯示桌號 (1 起算)
+
+    // --- 唯讀狀態 (開發機模擬器直接讀取，不經序列化) ---
+    const PlayerTable& table() const { return players; }
+    int phase() const { return nightPhase; }
+    int round() const { return roundCount; }
+    bool awaitingAction() const { return gameStarted && !gameOver && !isPhaseLocked && !hunterActionPending; }
+    bool awaitingHunter() const { return hunterActionPending; }
+    bool isOver() const { return gameOver; }
+    bool seatsLocked() const { return gameStarted || isStartingCountdown; } // 已發牌：座位不再變動
+    bool humansWon() const { return gameOver && winner == TEAM_HUMANS; }
+    int lastGuarded() const { return lastGuardedId; }
+    int wolfTarget() const { return wolfTargetId; }
+    const VoteBox& votes() const { return ballot; }
+    bool witchCanHeal() const { return witchHasHeal; }
+    bool witchCanPoison() const { return witchHasPoison; }
+    bool hunterCanShootNow() const { return hunterCanShoot; }
+    // 等待主控操作 (設定人數或同意續局)：多桌時搖桿與 OLED 交給此桌
+    bool needsAdmin() const {
+        return (!gameStarted && !isStartingCountdown && !confirmPressed) || (gameOver && !adminApprovedReset);
+    }
+
+private:
+    Hal& hal;
+
+    // --- 遊戲變數 ---
+    PlayerTable players;                     // 以座位為索引的玩家表
+    // --- 版本化差量同步 ---
+    // update 的每個欄位以 32 位元指紋表示；client 記錄上次送出的指紋，
+    // 之後只送出指紋不同的欄位 (delta)，重新連線或版本不符時改送完整快照
+    enum UpdateField {
+        UF_ROLE, UF_IS_DEAD, UF_PHASE, UF_GAME_OVER, UF_WINNER, UF_ADMIN_APPROVED,
+        UF_TARGETS, UF_PHASE_LOCKED, UF_HUNTER_PENDING, UF_COUNTDOWN, UF_IS_STARTING,
+        UF_IDIOT_REVEALED, UF_WAITING, UF_CURRENT_COUNT, UF_TARGET_COUNT, UF_VOTED,
+        UF_CAN_SHOOT, UF_DEATH_NOTE, UF_LAST_GUARDED, UF_HAS_HEAL, UF_HAS_POISON,
+        UF_WOLF_TARGET, UF_BALLOTS,
+        UF_COUNT
+    };
+    struct ClientSession {
+        int seat;
+        int sentIndex;                       // 已告知該 client 的玩家號碼 (-1 = 尚未)
+        bool binary;                         // 已協商 MessagePack
+        bool synced;                         // false: 下次送完整快照
+        bool deferred;                       // 佇列已滿而略過同步，待 flushDeferred() 補送
+        uint32_t sentVersion;                // client 目前持有的狀態版本
+        uint32_t sentView[UF_COUNT];         // client 目前持有的欄位指紋
+    };
+    std::map<uint32_t, ClientSession> clients; // WebSocket client -> 座位 (只含仍連線者)
+    int deferredClients = 0;                 // 略過同步、等待補送的 client 數
+    PlayerTable::Mask localSeats = 0;        // clientId 0 入座的本機玩家 (模擬器)：沒有連線也保留座位
+    PlayerTable::Mask lastNightDeadMask = 0; // V1.5: 紀錄昨晚死亡玩家
+
+    int targetPlayerCount = 7;
+    int currentPlayerCount = 0;
+    bool gameStarted = false;
+    bool isStartingCountdown = false;
+    unsigned long countdownStartTime = 0;
+    bool confirmPressed = false;
+    bool gameOver = false;
+    bool adminApprovedReset = false;
+    Team winner = TEAM_NONE;
+
+    int nightPhase = PHASE_NONE; // 見 role_traits.h 的 Phase (數值與網頁相同)
+    int roundCount = 1;
+    int wolfTargetId = -1;    // 以下目標皆為座位編號，-1 表示無
+    int witchPoisonId = -1;
+    bool witchHasHeal = true;
+    bool witchHasPoison = true;
+
+    // --- 新角色變數 ---
+    int lastGuardedId = -1;            // 守衛上一晚守的人
+    int currentGuardedId = -1;         // 守衛今晚守的人
+    bool hunterCanShoot = true;        // 獵人是否有子彈
+    int idiotId = -1;                  // 記錄誰是白痴 (翻牌記錄於 players.revealedMask)
+    RolePool rolePool = RolePool::standard();
+    VoteBox ballot;                    // 狼人刀人 / 白天放逐的逐人投票
+    VoteRules voteRules[VOTE_KINDS] = {
+        {TIE_RANDOM, 60000},           // 狼人：平票隨機，最多等 1 分鐘
+        {TIE_NO_ONE, 180000},          // 放逐：平票無人出局，最多等 3 分鐘
+    };
+    int roomNumber = 0;                // 桌號 (0 = 單桌，不顯示)
+    int roomCount = 1;
+
+    bool isPhaseLocked = false;
+    bool isSeerCheckPending = false;
+    AudioQueue audio;                        // 語音依序播放，不阻塞主迴圈
+    OledRenderer oledRenderer;               // OLED 只在畫面內容變動時繪製
+    enum CueEvent { CUE_NONE = 0, CUE_FAKE_TURN_END }; // 語音播完後的狀態轉移
+
+    // --- V1.4 新增變數 ---
+    bool hunterActionPending = false;      // 是否正在等待獵人行動
+
+    // --- 階段計時器 (到期時由 onTimer() 執行轉移) ---
+    enum GameTimer {
+        TM_COUNTDOWN,                      // 開局倒數 (每秒一次)
+        TM_OPEN_EYES,                      // 閉眼後播放睜眼語音並解鎖
+        TM_SEER_RESULT,                    // 預言家查驗結果顯示結束
+        TM_FAKE_TURN,                      // 神職已死的假回合
+        TM_VOTE,                           // 投票逾時，以已投的票結算
+        TM_COUNT
+    };
+    TimerSet<TM_COUNT> timers;
+    bool openEyesWaiting = false;          // 睜眼已到期但語音尚未播完
+
+    Metrics stats;
+    unsigned long lastMetricsPublish = 0;
+    unsigned long metricsPeriodMs = 1000;    // 0 = 不整理快照
+    ActionLog journal;                       // 外部輸入紀錄，供開發機重播
+    SnapshotStore snapshots;                 // 階段轉移後寫入非揮發儲存，重開機後接續
+    bool snapshotPending = false;            // 有變化尚未寫入快照 (廣播後才寫)
+    uint32_t snapshotPhase = 0;              // 上次排定快照時的階段 (見 stateChanged())
+    static const uint8_t SNAPSHOT_VERSION = 1;
+    bool checkpointPending = false;          // 開局或接續後，於下一次處理輸入前寫入行動紀錄檢查點
+    unsigned long checkpointAt = 0;          // 開局 (接續) 的時刻，檢查點內的時間以此為準
+
+    uint32_t stateVersion = 0;               // 每次廣播遞增
+    bool dirty = false;                      // 有變化尚未廣播
+    unsigned long lastBroadcast = 0;
+    uint32_t targetsVersion = 1;             // 可選目標名單內容變動時遞增
+    PlayerTable::Mask lastTargetsMask = 0;
+    uint32_t deathNoteVersion = 1;
+    char deathNote[96] = "";
+    int cdSec = 0;
+    uint32_t watchHash = 0;                  // 旁觀者頻道上次廣播內容的指紋 (0 = 下次必定廣播)
+
+    // 同一次同步內依 (角色, 生死, 翻牌, 欄位集合, 基準版本) 共用的訊框
+    struct FrameSlot {
+        int variant;
+        uint32_t mask;                       // 0 = 完整快照
+        uint32_t base;
+        bool binary;
+        SharedFrame frame;
+    };
+    static const int FRAME_CACHE = 24;
+    FrameSlot frameCache[FRAME_CACHE];
+    int frameCacheUsed = 0;
+
+    // --- 預先配置的序列化緩衝 ---
+    // 依最大座位數計算容量，隨物件一起靜態配置；同步時重複使用，不再逐次配置 heap
+    static const size_t UPDATE_DOC_CAPACITY =
+        JSON_OBJECT_SIZE(UF_COUNT + 5) +                                                         // 頂層欄位
+        JSON_ARRAY_SIZE(PlayerTable::CAPACITY) + PlayerTable::CAPACITY * JSON_OBJECT_SIZE(2) +   // targets
+        JSON_ARRAY_SIZE(PlayerTable::CAPACITY) +                                                 // votedPlayers
+        JSON_ARRAY_SIZE(PlayerTable::CAPACITY);                                                  // ballots
+    static const size_t MAX_FRAME = 768 + PlayerTable::CAPACITY * (2 * PlayerTable::ID_LEN + 28);
+    StaticJsonDocument<UPDATE_DOC_CAPACITY> updateDoc;
+    char frameOut[MAX_FRAME];                // 快取已滿或無法共用時的輸出緩衝
+    std::string metricsText;                 // 指標快照，開機時預留容量
+
+    void fillView(int seat, uint32_t* view);
+    void writeUpdate(JsonDocument& m, int seat, uint32_t mask, uint32_t base, bool binary);
+    void sendDoc(uint32_t clientId, JsonDocument& doc, bool binary);
+    void stateChanged();
+    void broadcast();
+    unsigned long syncClient(uint32_t clientId, ClientSession& cs);
+    void flushDeferred();
+    void publishWatch();
+    int watchChannel() const { return roomNumber ? roomNumber - 1 : 0; }
+    void publishMetrics();
+    size_t encodeSnapshot(uint8_t* out, size_t cap) const;
+    bool restoreSnapshot(const uint8_t* data, size_t len);
+    void saveSnapshot();
+    bool resume();
+    void scheduleCheckpoint();
+    size_t encodeCheckpoint(uint8_t* out, size_t cap);
+    void writeCheckpoint();
+
+    void playVoice(int fileID, unsigned long timeoutMs = AudioQueue::DEFAULT_TIMEOUT_MS,
+                   CueEvent followUp = CUE_NONE, int arg = 0);
+    void onCueDone(const AudioCue& cue);
+    void onTimer(int timer);
+    uint8_t onInput(InputEvent ev);                  // 回傳 LoopFlag (0 = 未使用)
+    void enterPhase(int phase);
+    void closePhase(int phase);
+    void startNight(bool nextRound);
+    void openVote(VoteKind kind);
+    void castVote(VoteKind kind, int seat, int target);
+    void closeVote();
+    void exile(int seat);
+    void startCountdown();
+    void triggerBuzzer(int type);
+    void checkVictory();
+    void setupRoles();
+    void resetGame();
+    int reclaimSeats();
+    int releaseSeats(PlayerTable::Mask drop);
+};
@@ -0,0 +1,127 @@
+/*
+ * =============================================================
+ * 硬體抽象層 (HAL)
+ * -------------------------------------------------------------
+ * 遊戲引擎只透過以下介面操作硬體；ESP32 實作位於 src/main.cpp，
+ * Linux 替身位於 src/native/，讓整個引擎能在開發機上建置與量測。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+// --- 音效：DFPlayer 與蜂鳴器 ---
+class AudioOut {
+public:
+    virtual ~AudioOut() {}
+    virtual void play(int fileID) = 0;
+    virtual bool isBusy() = 0;                      // 對應 DF_BUSY_PIN == LOW
+    virtual void tone(int freq, int durationMs) = 0;
+    virtual bool wakesOnIdle() { return false; }    // true: BUSY 轉閒時會喚醒遊戲工作 (中斷)，不需輪詢
+    virtual bool ready() { return true; }           // false: 喇叭由其他桌使用中 (多桌共用，見 room.h)
+};
+
+// --- OLED 顯示 (介面比照 U8g2 firstPage/nextPage 迴圈，全緩衝與頁緩衝模式皆適用) ---
+class Display {
+public:
+    virtual ~Display() {}
+    virtual void firstPage() = 0;
+    virtual bool nextPage() = 0;                    // false = 最後一頁已送出
+    virtual void drawStr(int x, int y, const char* s) = 0;
+    virtual void setCursor(int x, int y) = 0;
+    virtual void print(const char* s) = 0;
+    virtual void print(int v) = 0;
+};
+
+// --- 網路傳輸：以 clientId 定址的文字或二進位訊框 ---
+// 共用訊框：序列化一次後送給多個 client，全部送出後才釋放
+struct SharedFrame {
+    char* data = nullptr;   // 可寫入 len + 1 位元組
+    size_t len = 0;
+    bool binary = false;
+    void* impl = nullptr;   // 平台私有 (ESP32: AsyncWebSocketMessageBuffer)
+};
+
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual void text(uint32_t clientId, const char* data, size_t len) = 0;
+    virtual void binary(uint32_t clientId, const uint8_t* data, size_t len) = 0;
+
+    void send(uint32_t clientId, const char* data, size_t len, bool bin) {
+        if (bin) binary(clientId, (const uint8_t*)data, len);
+        else text(clientId, data, len);
+    }
+
+    virtual bool makeShared(SharedFrame& f, size_t len) {
+        f.data = (char*)malloc(len + 1); f.len = len;
+        return f.data != nullptr;
+    }
+    virtual void sendShared(uint32_t clientId, SharedFrame& f) { send(clientId, f.data, f.len, f.binary); }
+    virtual void releaseShared(SharedFrame& f) { free(f.data); f = SharedFrame(); }
+
+    // 背壓：false = client 待送佇列已滿 (或已離線)，本次同步略過，之後合併為一個差量補送
+    virtual bool canSend(uint32_t clientId) { return true; }
+    // 主動關閉連線 (同一裝置已由新連線接手)
+    virtual void close(uint32_t clientId) {}
+
+    // 指標用：client 的待送佇列長度與因佇列滿而丟棄的訊框數 (false = 不支援或已離線)
+    virtual bool clientStats(uint32_t clientId, uint32_t& queued, uint32_t& dropped) { return false; }
+
+    // 旁觀者頻道 (唯讀，每桌一個，channel 0 起算)：同一份文字訊框廣播給該頻道所有訂閱者
+    virtual int watchers(int channel) { return 0; }
+    virtual void broadcast(int channel, const char* data, size_t len) {}   // data 以 '\0' 結尾
+};
+
+// --- 實體輸入：搖桿 X 軸與按鍵，已去彈跳的事件 (取樣與去彈跳見 joystick.h) ---
+enum InputEvent : uint8_t {
+    JOY_NONE = 0,
+    JOY_UP,                                         // 搖桿右推 (推住不放會連發)
+    JOY_DOWN,                                       // 搖桿左推
+    JOY_BUTTON,                                     // 按鍵按下
+};
+
+class Input {
+public:
+    virtual ~Input() {}
+    virtual bool next(InputEvent& ev) = 0;          // 取出下一個事件，沒有則回傳 false (不阻塞)
+};
+
+// --- 時間 ---
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;             // 僅用於量測耗時
+    virtual void delay(unsigned long ms) = 0;
+};
+
+// --- 系統：亂數、記憶體與日誌 ---
+class System {
+public:
+    virtual ~System() {}
+    virtual long random(long lo, long hi) = 0;      // [lo, hi)
+    virtual uint32_t freeHeap() = 0;
+    virtual uint32_t minFreeHeap() { return freeHeap(); }       // 開機以來最低值
+    virtual uint32_t largestFreeBlock() { return freeHeap(); }  // 可一次配置的最大區塊
+    virtual void vlog(const char* fmt, va_list ap) = 0;
+    // 非揮發儲存 (ESP32 為 NVS)：不支援時讀取回傳 0、寫入回傳 false
+    virtual size_t loadBlob(const char* key, void* buf, size_t cap) { return 0; }
+    virtual bool saveBlob(const char* key, const void* data, size_t len) { return false; }
+
+    void log(const char* fmt, ...) {
+        va_list ap; va_start(ap, fmt); vlog(fmt, ap); va_end(ap);
+    }
+};
+
+struct Hal {
+    AudioOut& audio;
+    Display& display;
+    Transport& transport;
+    Input& input;
+    Clock& clock;
+    System& sys;
+};
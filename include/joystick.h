@@ -0,0 +1,52 @@
+/*
+ * =============================================================
+ * 搖桿輸入 (Debounced Joystick Events)
+ * -------------------------------------------------------------
+ * 取代主迴圈內 analogRead()/digitalRead() 後 delay(200)/delay(500) 的作法：
+ *   - 按鍵：GPIO 中斷記錄最後一次電位變化，電位穩定 DEBOUNCE_MS 才算數
+ *   - X 軸：週期取樣，進入 / 離開推桿區以不同門檻判斷 (遲滯)，避免在門檻附近抖動
+ *   - 推住不放：REPEAT_DELAY_MS 後每 REPEAT_MS 連發一次 (與原本 200 / 500 ms 的節奏相同)
+ * 去彈跳後的事件排入 SPSC 佇列，遊戲工作以 next() 取出，不再等待。
+ * sample() 只能由同一個工作呼叫 (ESP32：esp_timer)；edge() 可於 ISR 呼叫。
+ * 與硬體無關，開發機可用 program input 重播取樣紀錄。
+ * =============================================================
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "hal.h"
+#include "spsc_queue.h"
+
+class Joystick {
+public:
+    static const int UP_ENTER = 3600, UP_LEAVE = 3200;      // 原本的死區門檻 + 遲滯
+    static const int DOWN_ENTER = 400, DOWN_LEAVE = 800;
+    static const unsigned long SAMPLE_MS = 10;              // 建議取樣週期
+    static const unsigned long DEBOUNCE_MS = 30;
+    static const unsigned long REPEAT_DELAY_MS = 400;       // 推住後第一次連發
+    static const unsigned long REPEAT_MS = 200;             // 之後的連發間隔
+    static const unsigned long BUTTON_REPEAT_MS = 500;      // 按住按鍵的重複間隔
+
+    // 按鍵電位變化 (中斷)：彈跳期間不斷延後穩定判定
+    void edge(unsigned long now) { lastEdge.store((uint32_t)now, std::memory_order_relaxed); }
+    // 週期取樣；有新事件排入時回傳 true (呼叫端據此喚醒遊戲工作)
+    bool sample(unsigned long now, int axisX, bool pressed);
+    bool next(InputEvent& ev) { return events.pop(ev); }
+
+    uint32_t dropped = 0;                                   // 佇列滿而丟棄的事件
+
+private:
+    SpscQueue<InputEvent, 8> events;
+    std::atomic<uint32_t> lastEdge{0};                     // 由中斷寫入
+    uint32_t seenEdge = 0;
+
+    int axis = 0;                                           // -1 左推、0 中間、1 右推 (遲滯後)
+    unsigned long axisRepeatAt = 0;
+    bool raw = false;                                       // 最近一次取樣的按鍵電位
+    unsigned long rawSince = 0;                             // 電位最後一次變化的時間
+    bool button = false;                                    // 去彈跳後的按鍵狀態
+    unsigned long buttonRepeatAt = 0;
+
+    bool emit(InputEvent ev);
+};
@@ -0,0 +1,76 @@
+/*
+ * =============================================================
+ * 執行指標 (Metrics)
+ * -------------------------------------------------------------
+ * 熱路徑上只做計數與直方圖累加 (無字串、無 I/O)；
+ * 遊戲工作每秒把指標整理成 Prometheus 文字格式的快照，
+ * HTTP /metrics 由網路工作讀取快照，不需碰遊戲狀態。
+ * =============================================================
+ */
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+// 以 2 的冪次分桶：桶 i 的上限為 2^i (最後一桶為 +Inf)
+struct Histogram {
+    static const int BUCKETS = 16;
+    uint32_t counts[BUCKETS] = {};
+    uint32_t count = 0;
+    uint64_t sum = 0;
+    uint32_t max = 0;
+
+    void record(uint32_t v) {
+        int b = 0;
+        while (b < BUCKETS - 1 && v > (1u << b)) b++;
+        counts[b]++; count++; sum += v;
+        if (v > max) max = v;
+    }
+    void write(std::string& out, const char* name) const;
+};
+
+struct Metrics {
+    static const size_t SNAPSHOT_RESERVE = 6144;
+
+    Metrics() { snapshot.reserve(SNAPSHOT_RESERVE); }
+
+    // --- 記憶體 (每次同步取樣) ---
+    uint32_t heapFree = 0;
+    uint32_t heapMinFree = 0;            // 開機以來最低值
+    uint32_t heapLargestBlock = 0;
+
+    // --- 同步 ---
+    uint32_t stateChanges = 0;           // 狀態變動次數 (與 syncs 之差為合併掉的廣播)
+    uint32_t syncs = 0;
+    Histogram syncSerializeUs;           // 單次同步內序列化耗時
+    Histogram syncBroadcastUs;           // 單次同步內送出耗時
+    uint32_t framesSent = 0;
+    uint32_t watchFrames = 0;            // 旁觀者頻道廣播次數 (與旁觀人數無關)
+    uint32_t syncDeferred = 0;           // 因 client 佇列已滿而延後的同步
+    uint32_t sessionsEvicted = 0;        // 同一裝置重新連線而淘汰的舊連線
+
+    // --- 快照 ---
+    uint32_t snapshotWrites = 0;
+    uint32_t snapshotBytes = 0;          // 最近一次寫入的內容長度
+    Histogram snapshotWriteUs;           // 單次寫入非揮發儲存的耗時
+
+    // --- 主迴圈 ---
+    uint32_t wakeups = 0;
+    Histogram timerLateMs;               // 計時器實際執行時間 - 截止時間
+
+    // 由遊戲工作呼叫：整理成文字快照
+    void publish(const std::string& text) {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        snapshot = text;
+    }
+    // 由任何工作呼叫：取得最近一次快照
+    std::string read() {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        return snapshot;
+    }
+
+private:
+    std::mutex snapshotLock;
+    std::string snapshot;
+};
@@ -0,0 +1,62 @@
+/*
+ * =============================================================
+ * OLED 繪製元件 (View Model + 髒標記 + 限制幀率)
+ * -------------------------------------------------------------
+ * 遊戲工作只在同步時 publish() 一份小型 OledView，不碰 I2C；
+ * 繪製工作定期呼叫 render()，只有畫面內容變動且距上次繪製
+ * 超過 minFrameMs 時才實際傳送。兩者以 seqlock 交接：
+ * 寫入端 (遊戲工作) 從不等待，讀取端版本不一致時重讀。
+ * =============================================================
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "hal.h"
+
+struct OledView {
+    enum Screen : uint8_t { SETUP, WAITING, COUNTDOWN, GAME_OVER, PLAYING };
+
+    uint8_t screen = SETUP;
+    uint8_t targetCount = 0;     // 設定人數
+    uint8_t currentCount = 0;    // 已加入人數
+    uint8_t countdown = 0;       // 開局倒數秒數
+    bool humansWon = false;
+    bool adminApproved = false;  // 主控已同意續局
+    uint8_t readyCount = 0;      // 續局已準備人數
+    uint8_t round = 0;
+    int8_t nightPhase = -1;
+    uint8_t room = 0;            // 桌號 (0 = 單桌，不顯示)
+
+    bool operator==(const OledView& o) const {
+        return room == o.room && screen == o.screen && targetCount == o.targetCount && currentCount == o.currentCount &&
+               countdown == o.countdown && humansWon == o.humansWon && adminApproved == o.adminApproved &&
+               readyCount == o.readyCount && round == o.round && nightPhase == o.nightPhase;
+    }
+    bool operator!=(const OledView& o) const { return !(*this == o); }
+};
+
+class OledRenderer {
+public:
+    OledRenderer(Display& display, Clock& clock, unsigned long minFrameMs = 100)
+        : display(display), clock(clock), minFrameMs(minFrameMs) {}
+
+    void publish(const OledView& v);    // 遊戲工作：只複製 view model
+    bool render();                      // 繪製工作：有變動且到期才繪製，回傳是否送出
+    void invalidate() { hasShown = false; } // 繪製工作：畫面被其他桌覆蓋過，下次 render() 必定重畫
+
+    unsigned long frames = 0, published = 0;
+
+private:
+    void draw(const OledView& v);
+
+    Display& display;
+    Clock& clock;
+    unsigned long minFrameMs;
+
+    std::atomic<uint32_t> seq{0};       // 奇數 = 寫入中
+    OledView pending;
+    OledView shown;
+    bool hasShown = false;
+    unsigned long lastFrame = 0;
+};
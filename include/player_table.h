@@ -0,0 +1,74 @@
+/*
+ * =============================================================
+ * 座位表 (Seat-indexed Player Table)
+ * -------------------------------------------------------------
+ * 以座位編號為索引的固定容量結構陣列 (SoA)：
+ *   - deviceId 於 connect 時登錄 (intern) 一次，之後全以座位編號操作
+ *   - 存活/翻牌/續局投票皆為位元遮罩，角色另以遮罩索引
+ *   - 大廳中離開的座位可釋放 (release)，其餘座位依原順序遞補，容量不會被用光
+ * 所有查詢皆為 O(1)，同步過程中不做任何堆積配置。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// --- 角色 ---
+enum Role : uint8_t {
+    ROLE_JOINED = 0,     // 已加入、尚未分配
+    ROLE_SPECTATOR,      // 旁觀者
+    ROLE_VILLAGER,       // 平民
+    ROLE_WOLF,           // 狼人
+    ROLE_SEER,           // 預言家
+    ROLE_WITCH,          // 女巫
+    ROLE_HUNTER,         // 獵人
+    ROLE_GUARD,          // 守衛
+    ROLE_IDIOT,          // 白痴
+    ROLE_COUNT
+};
+
+// 陣營、行動階段與顯示名稱見 role_traits.h
+
+struct PlayerTable {
+    static const int CAPACITY = 32;     // 15 名玩家 + 旁觀者與重新連線
+    static const int ID_LEN = 24;       // deviceId 最長 23 字元
+    typedef uint32_t Mask;
+
+    int count = 0;                      // 已登錄座位數
+    uint32_t idHash[CAPACITY];
+    char deviceId[CAPACITY][ID_LEN];
+    uint8_t role[CAPACITY];
+    uint8_t index[CAPACITY];            // 玩家號碼 (1 起算, 0 = 未入座)
+
+    Mask roleMask[ROLE_COUNT] = {};
+    Mask aliveMask = 0;
+    Mask revealedMask = 0;              // 白痴翻牌
+    Mask votedMask = 0;                 // 續局投票
+
+    static Mask bit(int seat) { return (Mask)1u << seat; }
+    static int popcount(Mask m) { return __builtin_popcount(m); }
+
+    Mask usedMask() const { return count >= 32 ? ~(Mask)0 : bit(count) - 1; }
+
+    int find(const char* devId) const;          // 找不到回傳 -1
+    int intern(const char* devId);              // 找不到則新增；座位已滿回傳 -1
+    // 釋放 drop 內的座位，其餘依原順序往前遞補；moved[舊座位] = 新座位 (已釋放為 -1)
+    void release(Mask drop, int8_t* moved);
+    static Mask remap(Mask m, const int8_t* moved);
+    static int remap(int seat, const int8_t* moved) { return seat >= 0 ? moved[seat] : -1; }
+
+    void setRole(int seat, Role r) {
+        roleMask[role[seat]] &= ~bit(seat);
+        role[seat] = r;
+        roleMask[r] |= bit(seat);
+    }
+
+    bool isAlive(int seat) const { return seat < 0 || (aliveMask & bit(seat)); }
+    void kill(int seat) { if (seat >= 0) aliveMask &= ~bit(seat); }
+    bool isRoleAlive(Role r) const { return (roleMask[r] & aliveMask) != 0; }
+    int aliveCount(Role r) const { return popcount(roleMask[r] & aliveMask); }
+
+    const char* idOf(int seat) const { return seat >= 0 ? deviceId[seat] : ""; }
+    Role roleOf(int seat) const { return seat >= 0 ? (Role)role[seat] : ROLE_JOINED; }
+};
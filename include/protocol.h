@@ -0,0 +1,92 @@
+/*
+ * =============================================================
+ * WebSocket 協定：動作代碼、訊息種類與欄位標籤
+ * -------------------------------------------------------------
+ * JSON 模式 (預設)：文字訊框，沿用原本的長欄位名稱。
+ * MessagePack 模式：網頁在 connect 時帶 "proto":"mp" 協商，
+ * 之後雙向皆為二進位訊框，欄位改用短標籤，動作與角色改用整數代碼。
+ * 網頁端 (web/index.html) 的 TAGS / ACTIONS / ROLES 需與此表一致。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "player_table.h"
+
+// --- 玩家動作 (二進位模式以整數代碼傳送) ---
+enum Action : uint8_t {
+    ACT_NONE = 0,
+    ACT_CONNECT,
+    ACT_RESYNC,
+    ACT_RESTART,
+    ACT_GUARD_PROTECT,
+    ACT_WOLF_KILL,
+    ACT_SEER_CHECK,
+    ACT_WITCH_HEAL,
+    ACT_WITCH_POISON,
+    ACT_WITCH_SKIP,
+    ACT_CHAMP_EXILE,
+    ACT_HUNTER_SHOOT,
+    // 以下只由伺服器產生；parseCommand() 一律視為 ACT_NONE
+    ACT_WATCH,          // 旁觀者頻道有新連線 (由伺服器產生)：下次同步必定廣播
+    ACT_DISCONNECT,     // 連線已關閉或逾時 (由伺服器產生)：移除同步狀態；開局後座位保留
+    ACT_COUNT,
+    ACT_CLIENT_COUNT = ACT_WATCH        // 網頁可送出的動作代碼上限 (不含)
+};
+
+const char* actionName(Action a);
+Action actionFromName(const char* name);
+
+// --- 伺服器送出的訊息種類 ---
+enum MsgType : uint8_t {
+    MSG_UPDATE = 0,     // 完整快照
+    MSG_DELTA,          // 差量
+    MSG_SEAT,           // 玩家號碼
+    MSG_SEER_RESULT,    // 預言家查驗結果
+    MSG_WATCH,          // 旁觀者頻道：公開資訊，所有旁觀者共用同一份
+    MSG_FULL,           // 座位已滿：本次 connect 未入座
+    MSG_GO_WATCH,       // 已開局：新裝置不入座，改連旁觀者頻道
+    MSG_TYPE_COUNT
+};
+
+// --- 欄位名稱 ---
+enum WireKey : uint8_t {
+    // 輸入
+    K_ACTION, K_DEVICE_ID, K_TARGET_ID, K_PROTO, K_ROOM,
+    // 輸出
+    K_TYPE, K_BASE, K_VERSION, K_ROLE, K_INDEX, K_ID, K_IS_DEAD, K_PHASE,
+    K_GAME_OVER, K_WINNER, K_ADMIN_APPROVED, K_TARGETS, K_PHASE_LOCKED,
+    K_HUNTER_PENDING, K_COUNTDOWN, K_IS_STARTING, K_IDIOT_REVEALED, K_WAITING,
+    K_CURRENT_COUNT, K_TARGET_COUNT, K_VOTED, K_CAN_SHOOT, K_DEATH_NOTE,
+    K_LAST_GUARDED, K_HAS_HEAL, K_HAS_POISON, K_WOLF_TARGET_INDEX, K_WOLF_TARGET_ID,
+    K_ROOMS, K_ROUND, K_PLAYERS, K_BALLOTS, K_VOTERS,
+    K_COUNT
+};
+
+struct WireName {
+    const char* json;   // JSON 模式
+    const char* tag;    // MessagePack 模式
+};
+
+extern const WireName WIRE_KEYS[K_COUNT];
+extern const WireName MSG_TYPES[MSG_TYPE_COUNT];
+
+inline const char* wireKey(WireKey k, bool binary) { return binary ? WIRE_KEYS[k].tag : WIRE_KEYS[k].json; }
+inline const char* msgType(MsgType t, bool binary) { return binary ? MSG_TYPES[t].tag : MSG_TYPES[t].json; }
+
+// --- 解析後的玩家指令 ---
+// 固定大小、不含指標，可直接放入跨工作佇列 (WebSocket 工作 -> 遊戲工作)
+struct Command {
+    uint32_t clientId = 0;
+    Action action = ACT_NONE;
+    bool binary = false;                     // 來源為二進位訊框
+    bool wantsMsgPack = false;               // connect 帶 "proto":"mp"
+    char deviceId[PlayerTable::ID_LEN] = "";
+    char targetId[PlayerTable::ID_LEN] = ""; // 空字串 = 空守/棄票
+    uint8_t room = 0;                        // 桌號 (1 起算)；0 = 未指定，沿用目前所在的桌
+};
+
+// 只解析、不碰遊戲狀態；格式錯誤或動作不是網頁可送出的 (含伺服器專用) 回傳 false。
+// 過長的 ID 視為空字串 (與 PlayerTable 一致)
+bool parseCommand(uint32_t clientId, const char* data, size_t len, bool binary, Command& out);
@@ -0,0 +1,41 @@
+/*
+ * =============================================================
+ * 角色池 (Role Pool)
+ * -------------------------------------------------------------
+ * 原本寫死在 setupRoles() 的配置 (7 人加獵人、9 人第三狼 ...) 改為資料：
+ * 依序列出特殊角色與其最低人數，不足的座位補平民；
+ * 6-15 人的配置於設定時預先展開 (prepare)，開局只需複製。
+ * 文字格式供開發機模擬器掃描替代配置，例如預設池：
+ *   wolf,wolf,seer,witch,hunter@7,wolf@9,guard@10,wolf@12,idiot@13
+ * =============================================================
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "player_table.h"
+#include "role_traits.h"
+
+struct RolePool {
+    static const int MAX_STEPS = 16;
+    static const int MIN_PLAYERS = 6;       // 主控可設定的人數範圍
+    static const int MAX_PLAYERS = 15;
+    struct Step {
+        uint8_t minPlayers;     // 達此人數才加入
+        Role role;
+    };
+    Step steps[MAX_STEPS];
+    int count = 0;
+    Role deals[MAX_PLAYERS + 1][MAX_PLAYERS];   // 各人數的角色池 (未洗牌)
+
+    static RolePool standard();
+
+    // 依人數產生角色池 (依列出順序，不足補平民)，回傳張數
+    int build(int players, Role* out, int cap) const;
+    // 同 build()，範圍內的人數直接取預先展開的結果
+    int deal(int players, Role* out, int cap) const;
+    void prepare();
+    // 解析文字格式；格式錯誤回傳 false
+    bool parse(const char* spec);
+    void format(char* out, size_t len) const;
+};
@@ -0,0 +1,117 @@
+/*
+ * =============================================================
+ * 角色與階段特性表 (Role / Phase Traits)
+ * -------------------------------------------------------------
+ * 陣營、行動階段、語音編號與顯示名稱集中為編譯期常數表：
+ *   - 引擎只以 Role / Phase / Team 查表，規則判斷不做字串比對
+ *   - 中文名稱、勝方名稱只在輸出 (JSON、OLED) 時查表取得
+ *   - 角色表與階段表互相對應，於編譯時以 static_assert 檢查
+ * 語音編號對應 SD 卡上的 DFPlayer 音檔。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include "player_table.h"
+
+// --- 語音 (DFPlayer 音檔編號) ---
+enum Track : uint8_t {
+    TRACK_NONE        = 0,
+    TRACK_NIGHT       = 1,      // 天黑請閉眼
+    TRACK_WOLF_OPEN   = 2,  TRACK_WOLF_CLOSE   = 3,
+    TRACK_SEER_OPEN   = 4,  TRACK_SEER_CLOSE   = 5,
+    TRACK_WITCH_OPEN  = 6,  TRACK_WITCH_CLOSE  = 8,
+    TRACK_DAY         = 9,      // 天亮了
+    TRACK_GUARD_OPEN  = 12, TRACK_GUARD_CLOSE  = 13,
+    TRACK_HUNTER_CALL = 14,     // V1.4 MOD: 獵人行動提示音 (ID 14 為示意)
+    TRACK_HUNTER_SHOT = 15,     // V1.4 MOD: 獵人開槍音效 (ID 15 為示意, 請更換為實際音檔)
+    TRACK_HUMANS_WIN  = 20,     // V1.5: 好人勝利音效 (請替換為您的音檔ID)
+    TRACK_WOLVES_WIN  = 21,     // V1.5: 狼人勝利音效
+};
+
+// --- 陣營 ---
+enum Team : uint8_t {
+    TEAM_NONE,           // 未分配 / 旁觀，不計入勝負
+    TEAM_HUMANS,
+    TEAM_WOLVES,
+    TEAM_COUNT
+};
+
+struct TeamTraits {
+    const char* name;    // 網頁的 winner 欄位
+    Track winTrack;
+};
+
+constexpr TeamTraits TEAM_TRAITS[TEAM_COUNT] = {
+    /* TEAM_NONE   */ {"NONE",   TRACK_NONE},
+    /* TEAM_HUMANS */ {"HUMANS", TRACK_HUMANS_WIN},
+    /* TEAM_WOLVES */ {"WOLVES", TRACK_WOLVES_WIN},
+};
+
+// --- 階段 (數值即協定中的 phase，網頁以此顯示) ---
+enum Phase : int8_t {
+    PHASE_NONE  = -1,    // 等待開局
+    PHASE_WOLF  = 0,
+    PHASE_SEER  = 1,
+    PHASE_WITCH = 2,
+    PHASE_DAY   = 3,
+    PHASE_GUARD = 4,
+    PHASE_COUNT
+};
+
+// 行動完成 (或神職已死的假回合結束) 時播放閉眼語音並進入 next；
+// 進入新階段後鎖定介面，睜眼計時到期後播放睜眼語音並解鎖
+struct PhaseTraits {
+    Role actor;          // 行動角色 (ROLE_COUNT = 全體，白天)
+    Track openTrack;     // 睜眼 / 天亮語音
+    Track closeTrack;    // 閉眼語音 (TRACK_NONE = 無)
+    Phase next;          // 下一階段 (PHASE_NONE = 進入新夜晚)
+    const char* oled;    // OLED 顯示
+};
+
+constexpr PhaseTraits PHASE_TRAITS[PHASE_COUNT] = {
+    /* 0 狼人   */ {ROLE_WOLF,  TRACK_WOLF_OPEN,  TRACK_WOLF_CLOSE,  PHASE_SEER,  "WOLF ACTING"},
+    /* 1 預言家 */ {ROLE_SEER,  TRACK_SEER_OPEN,  TRACK_SEER_CLOSE,  PHASE_WITCH, "SEER ACTING"},
+    /* 2 女巫   */ {ROLE_WITCH, TRACK_WITCH_OPEN, TRACK_WITCH_CLOSE, PHASE_DAY,   "WITCH ACTING"},
+    /* 3 白天   */ {ROLE_COUNT, TRACK_DAY,        TRACK_NONE,        PHASE_NONE,  "VOTING TIME"},
+    /* 4 守衛   */ {ROLE_GUARD, TRACK_GUARD_OPEN, TRACK_GUARD_CLOSE, PHASE_WOLF,  "GUARD ACTING"},
+};
+
+// --- 角色 ---
+struct RoleTraits {
+    Team team;
+    Phase phase;         // 夜晚行動的階段 (PHASE_NONE = 無)
+    const char* name;    // 網頁顯示與比對的中文名稱
+    const char* key;     // 角色池文字格式 (空字串 = 不可列入)
+};
+
+constexpr RoleTraits ROLE_TRAITS[ROLE_COUNT] = {
+    /* ROLE_JOINED    */ {TEAM_NONE,   PHASE_NONE,  "Joined", ""},
+    /* ROLE_SPECTATOR */ {TEAM_NONE,   PHASE_NONE,  "旁觀者", ""},
+    /* ROLE_VILLAGER  */ {TEAM_HUMANS, PHASE_NONE,  "平民",   "villager"},
+    /* ROLE_WOLF      */ {TEAM_WOLVES, PHASE_WOLF,  "狼人",   "wolf"},
+    /* ROLE_SEER      */ {TEAM_HUMANS, PHASE_SEER,  "預言家", "seer"},
+    /* ROLE_WITCH     */ {TEAM_HUMANS, PHASE_WITCH, "女巫",   "witch"},
+    /* ROLE_HUNTER    */ {TEAM_HUMANS, PHASE_NONE,  "獵人",   "hunter"},
+    /* ROLE_GUARD     */ {TEAM_HUMANS, PHASE_GUARD, "守衛",   "guard"},
+    /* ROLE_IDIOT     */ {TEAM_HUMANS, PHASE_NONE,  "白痴",   "idiot"},
+};
+
+constexpr const char* roleName(uint8_t role) { return role < ROLE_COUNT ? ROLE_TRAITS[role].name : ""; }
+constexpr const char* teamName(Team team) { return TEAM_TRAITS[team].name; }
+
+// 陣營內所有角色 (以角色編號為位元)
+constexpr uint32_t teamRoles(Team team, int r = 0) {
+    return r >= ROLE_COUNT ? 0 : ((ROLE_TRAITS[r].team == team ? 1u << r : 0) | teamRoles(team, r + 1));
+}
+
+// 階段表的行動角色與角色表的行動階段必須互相一致
+constexpr bool phasesMatchRoles(int p = 0) {
+    return p >= PHASE_COUNT ||
+           ((PHASE_TRAITS[p].actor == ROLE_COUNT || ROLE_TRAITS[PHASE_TRAITS[p].actor].phase == p) && phasesMatchRoles(p + 1));
+}
+constexpr bool rolesMatchPhases(int r = 0) {
+    return r >= ROLE_COUNT ||
+           ((ROLE_TRAITS[r].phase == PHASE_NONE || PHASE_TRAITS[ROLE_TRAITS[r].phase].actor == r) && rolesMatchPhases(r + 1));
+}
+static_assert(phasesMatchRoles() && rolesMatchPhases(), "PHASE_TRAITS / ROLE_TRAITS mismatch");
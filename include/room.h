@@ -0,0 +1,103 @@
+/*
+ * =============================================================
+ * 多桌遊戲室 (RoomSet)
+ * -------------------------------------------------------------
+ * 一塊控制板同時主持多桌，每桌是獨立的 WerewolfGame：
+ * 玩家表、階段、計時器、語音佇列與行動紀錄各自獨立，
+ * 同步只送給該桌的連線，成本與其他桌無關。
+ *   - 喇叭只有一個：SharedSpeaker 讓各桌語音逐段輪流播放
+ *   - 搖桿與 OLED 交給「主控桌」：目前等待主控操作的桌優先
+ *   - WebSocket 指令依連線所在的桌轉送；connect 可帶 "room" 換桌
+ *     (大廳中換桌即讓出原桌座位；原桌已開局且在座則拒絕)
+ * 桌數上限 MAX_ROOMS 於編譯時決定，物件隨 RoomSet 靜態配置。
+ * =============================================================
+ */
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <new>
+#include "game.h"
+
+#ifndef MAX_ROOMS
+#define MAX_ROOMS 2
+#endif
+
+// --- 共用喇叭：一次只有一桌播放，播完後輪到下一個等待中的桌 ---
+class SharedSpeaker {
+public:
+    static const unsigned long HOLD_LIMIT_MS = 15000;   // BUSY 卡住時最長佔用
+    static const unsigned long STALE_MS = 200;          // 等待中的桌至少每 POLL_MS 詢問一次
+
+    SharedSpeaker(AudioOut& out, Clock& clock) : out(out), clock(clock) {}
+
+    // 各桌使用的音效通道
+    class Channel : public AudioOut {
+    public:
+        Channel(SharedSpeaker& s, int id) : s(s), id(id) {}
+        void play(int fileID) override { s.play(id, fileID); }
+        bool isBusy() override { return s.owner == id && s.out.isBusy(); } // 已被他桌接手 = 本段已播完
+        void tone(int freq, int durationMs) override { s.out.tone(freq, durationMs); }
+        bool wakesOnIdle() override { return s.out.wakesOnIdle(); }
+        bool ready() override { return s.ready(id); }
+    private:
+        SharedSpeaker& s;
+        int id;
+    };
+
+private:
+    AudioOut& out;
+    Clock& clock;
+    int owner = -1;                  // 最後播放的桌
+    unsigned long startedAt = 0;
+    uint32_t waiting = 0;            // 等待喇叭的桌 (位元遮罩)
+    unsigned long askedAt[MAX_ROOMS] = {};
+
+    bool ready(int ch);
+    void play(int ch, int fileID);
+};
+
+class RoomSet {
+public:
+    RoomSet(Hal& hal, int count);
+    ~RoomSet();
+
+    void begin();
+    void handleCommand(const Command& cmd);      // 依連線所在的桌轉送 (僅限遊戲工作)
+    unsigned long loop();                        // 推進每一桌，回傳距下次需呼叫的毫秒數
+
+    int count() const { return rooms; }
+    WerewolfGame& game(int i) { return at(i).game; }
+    int focus() const { return focused.load(std::memory_order_relaxed); } // 可由繪製工作讀取
+    bool render();                               // 繪製工作：畫出主控桌的 OLED 畫面
+
+private:
+    // 搖桿事件只交給主控桌，非主控桌收不到事件
+    class RoomInput : public Input {
+    public:
+        RoomInput(RoomSet& set, int id) : set(set), id(id) {}
+        bool next(InputEvent& ev) override { return set.focus() == id && set.hal.input.next(ev); }
+    private:
+        RoomSet& set;
+        int id;
+    };
+
+    struct Room {
+        SharedSpeaker::Channel audio;
+        RoomInput input;
+        Hal hal;
+        WerewolfGame game;
+        Room(RoomSet& set, int id);
+    };
+
+    Hal& hal;
+    SharedSpeaker speaker;
+    int rooms;
+    std::atomic<int> focused{0};
+    int shownFocus = -1;                         // 繪製工作專用
+    std::map<uint32_t, uint8_t> clientRoom;      // WebSocket client -> 桌 (0 起算)
+    alignas(Room) unsigned char storage[MAX_ROOMS][sizeof(Room)];
+
+    Room& at(int i) { return *reinterpret_cast<Room*>(storage[i]); }
+    void updateFocus();
+};
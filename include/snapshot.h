@@ -0,0 +1,84 @@
+/*
+ * =============================================================
+ * 遊戲快照 (Crash-safe Snapshot Store)
+ * -------------------------------------------------------------
+ * 每次階段轉移後把規則狀態編成精簡的二進位快照寫入非揮發儲存
+ * (ESP32 為 NVS，開發機為檔案)，當機或斷電重開後即可接續同一局，
+ * 手機以原本的 deviceId 重新連線就回到原座位。
+ *   - 兩個槽輪流寫入：寫到一半斷電只會毀掉較新的一槽，另一槽仍完整
+ *   - 開機時取序號較大且 CRC 正確的一槽
+ *   - 內容與上次寫入相同時略過，投票等不影響快照的變化不會寫入
+ *   - 寫入失敗 (不支援或空間已滿) 後停用，不再於每次轉移重試
+ *
+ * 槽格式 (little-endian)：
+ *   "WWSN" | u32 序號 | u16 內容長度 | u32 CRC-32 (序號、長度與內容) | 內容
+ * 內容由 WerewolfGame 編碼，第一個 byte 為其版本。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "hal.h"
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+// --- 依序寫入 / 讀出定長欄位 (超出範圍後 ok 為 false) ---
+struct ByteWriter {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok = true;
+
+    ByteWriter(uint8_t* buf, size_t cap) : p(buf), end(buf + cap) {}
+    void u8(uint32_t v) { if (p < end) *p++ = (uint8_t)v; else ok = false; }
+    void u32(uint32_t v) { for (int i = 0; i < 4; i++) u8(v >> (8 * i)); }
+    void bytes(const void* src, size_t n) {
+        if ((size_t)(end - p) < n) { ok = false; return; }
+        memcpy(p, src, n); p += n;
+    }
+};
+
+struct ByteReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    ByteReader(const uint8_t* buf, size_t len) : p(buf), end(buf + len) {}
+    uint8_t u8() { if (p < end) return *p++; ok = false; return 0; }
+    int8_t i8() { return (int8_t)u8(); }
+    uint32_t u32() { uint32_t v = 0; for (int i = 0; i < 4; i++) v |= (uint32_t)u8() << (8 * i); return v; }
+    bool bytes(void* dst, size_t n) {
+        if ((size_t)(end - p) < n) { ok = false; return false; }
+        memcpy(dst, p, n); p += n;
+        return true;
+    }
+};
+
+class SnapshotStore {
+public:
+    static const size_t HEADER_LEN = 14;
+    static const size_t MAX_PAYLOAD = 1024;     // 32 座位皆為最長 deviceId 時約 870 bytes
+
+    explicit SnapshotStore(System& sys) : sys(sys) {}
+
+    void begin(int room);                       // 決定本桌的槽名稱 (開機時一次)
+    uint8_t* payload() { return slot + HEADER_LEN; } // 編碼 / 解碼的內容緩衝
+    size_t load();                              // 較新的有效槽讀入 payload()；都無效回傳 0
+    bool changed(size_t len);                   // payload() 的內容與上次寫入不同
+    bool commit(size_t len);                    // 寫入較舊的一槽 (先呼叫 changed())
+    bool enabled() const { return !disabled; }
+    uint32_t crc() const { return lastCrc; }    // 最近一次讀出或寫入的內容 CRC
+
+private:
+    System& sys;
+    char keys[2][12];
+    uint32_t seq = 0;                           // 最近一次寫入 (或開機讀出) 的序號
+    int next = 0;                               // 下次寫入的槽
+    uint32_t lastCrc = 0, pendingCrc = 0;
+    size_t lastLen = 0;
+    bool disabled = false;
+    uint8_t slot[HEADER_LEN + MAX_PAYLOAD];     // 隨物件靜態配置，寫入時不配置 heap
+
+    size_t readSlot(int i, uint32_t& seqOut);   // 讀入並驗證，回傳內容長度 (0 = 無效)
+};
@@ -0,0 +1,45 @@
+/*
+ * =============================================================
+ * 單一生產者 / 單一消費者無鎖佇列 (SPSC Ring Buffer)
+ * -------------------------------------------------------------
+ * 生產者只寫 head、消費者只寫 tail，兩端各自以 acquire/release
+ * 讀取對方索引，不需互斥鎖。容量 N 必須為 2 的冪次。
+ * push() 只能由同一個工作呼叫，pop() 亦然。
+ * =============================================================
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // 生產者：佇列已滿時回傳 false (不覆寫)
+    bool push(const T& v) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) return false;
+        buf[h & (N - 1)] = v;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消費者：佇列為空時回傳 false
+    bool pop(T& v) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        v = buf[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+private:
+    T buf[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
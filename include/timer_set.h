@@ -0,0 +1,57 @@
+/*
+ * =============================================================
+ * 截止時間表 (Deadline Timers)
+ * -------------------------------------------------------------
+ * 固定數量、以編號定址的單次計時器。主迴圈取出到期者執行，
+ * 並以 nextIn() 得知距下一個截止時間還有多久，
+ * 工作可直接睡到那一刻，不需每 10ms 輪詢。時間比較可跨越 millis() 溢位。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+
+template <int N>
+class TimerSet {
+    static_assert(N <= 32, "TimerSet supports at most 32 timers");
+
+public:
+    void arm(int id, unsigned long now, unsigned long delayMs) {
+        due[id] = now + delayMs;
+        armedMask |= 1u << id;
+    }
+    void disarm(int id) { armedMask &= ~(1u << id); }
+    void clear() { armedMask = 0; }
+    bool armed(int id) const { return armedMask & (1u << id); }
+    unsigned long dueAt(int id) const { return due[id]; }
+
+    // 取出最早到期的計時器並解除 (-1 = 尚無到期者)；lateMs 為超過截止時間的毫秒數
+    int takeDue(unsigned long now, unsigned long* lateMs = nullptr) {
+        int best = -1;
+        for (int i = 0; i < N; i++) {
+            if (!armed(i) || (long)(due[i] - now) > 0) continue;
+            if (best < 0 || (long)(due[i] - due[best]) < 0) best = i;
+        }
+        if (best >= 0) {
+            disarm(best);
+            if (lateMs) *lateMs = now - due[best];
+        }
+        return best;
+    }
+
+    // 距最早截止時間的毫秒數；已到期為 0，沒有計時器時為 cap
+    unsigned long nextIn(unsigned long now, unsigned long cap) const {
+        unsigned long wait = cap;
+        for (int i = 0; i < N; i++) {
+            if (!armed(i)) continue;
+            long left = (long)(due[i] - now);
+            if (left <= 0) return 0;
+            if ((unsigned long)left < wait) wait = left;
+        }
+        return wait;
+    }
+
+private:
+    unsigned long due[N] = {};
+    uint32_t armedMask = 0;
+};
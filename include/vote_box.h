@@ -0,0 +1,54 @@
+/*
+ * =============================================================
+ * 投票箱 (Vote Box)
+ * -------------------------------------------------------------
+ * 狼人刀人與白天放逐改為逐人投票，不再由第一個送出者決定全桌結果：
+ *   - 有投票權、已投票皆為座位位元遮罩；每個目標另記支持者遮罩與票數
+ *   - 每人一票，投出後不可更改；全員投完或逾時即結算
+ *   - 最高票須多於棄票 (含逾時未投)：一人投 X、其餘全棄票時無人出局 / 空刀
+ *   - 平票與逾時規則依投票種類設定 (VoteRules)
+ * 投票過程只改變已投票名單，結算時才觸發階段轉移。
+ * =============================================================
+ */
+#pragma once
+
+#include <stdint.h>
+#include "player_table.h"
+
+enum VoteKind : uint8_t {
+    VOTE_WOLF,           // 夜晚：存活狼人決定刀口
+    VOTE_EXILE,          // 白天：存活且未翻牌的玩家放逐
+    VOTE_KINDS
+};
+
+enum TieRule : uint8_t {
+    TIE_NO_ONE,          // 平票：無人出局 / 空刀
+    TIE_RANDOM,          // 平票：最高票者中隨機一人
+};
+
+struct VoteRules {
+    TieRule tie;
+    unsigned long timeoutMs;            // 開票後最長等待 (0 = 等全員投完)；逾時未投視同棄票
+};
+
+struct VoteBox {
+    typedef PlayerTable::Mask Mask;
+    static const int ABSTAIN = PlayerTable::CAPACITY;   // 棄票 / 空刀的計票位置
+
+    bool open = false;
+    VoteKind kind = VOTE_WOLF;
+    Mask eligible = 0;                  // 有投票權的座位
+    Mask cast = 0;                      // 已投票的座位
+    Mask backers[PlayerTable::CAPACITY + 1];            // 各目標的支持者
+    uint8_t tally[PlayerTable::CAPACITY + 1];           // 各目標目前票數
+
+    void begin(VoteKind k, Mask voters);
+    // target -1 = 棄票；無投票權、已投過或未開票回傳 false
+    bool vote(int voter, int target);
+    bool complete() const { return open && (eligible & ~cast) == 0; }
+    int abstentions() const { return tally[ABSTAIN] + PlayerTable::popcount(eligible & ~cast); } // 棄票 + 未投
+    Mask leaders() const;               // 最高票且多於棄票的目標 (否則為 0)
+    bool tied() const { return PlayerTable::popcount(leaders()) > 1; }
+    // 結算並關閉：回傳出局座位 (-1 = 無)；rnd 只在平票且 TIE_RANDOM 時使用
+    int close(TieRule tie, uint32_t rnd);
+};
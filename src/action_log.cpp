@@ -0,0 +1,191 @@
+#include "action_log.h"
+#include <algorithm>
+#include <string.h>
+
+const size_t ActionLog::CHECKPOINT_CHUNK; // std::min() 以參考取用，需要類別外定義
+
+static size_t putVarint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static size_t putId(uint8_t* p, int seat, const char* id) {
+    if (seat >= 0) { p[0] = (uint8_t)(seat + 1); return 1; }
+    size_t n = strlen(id);
+    if (n == 0) { p[0] = 0; return 1; }
+    p[0] = ID_LITERAL; p[1] = (uint8_t)n;
+    memcpy(p + 2, id, n);
+    return n + 2;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// --- 寫入 ---
+
+void ActionLog::command(unsigned long now, const Command& cmd, int devSeat, int targetSeat) {
+    uint8_t p[8 + 2 * (PlayerTable::ID_LEN + 2)];
+    size_t n = putVarint(p, cmd.clientId);
+    p[n++] = cmd.action;
+    p[n++] = (cmd.binary ? CMD_BINARY : 0) | (cmd.wantsMsgPack ? CMD_WANTS_MSGPACK : 0);
+    n += putId(p + n, devSeat, cmd.deviceId);
+    n += putId(p + n, targetSeat, cmd.targetId);
+    append(LOG_COMMAND, now, p, n);
+}
+
+void ActionLog::loop(unsigned long now, uint8_t timers, uint8_t flags) {
+    uint8_t p[2] = {timers, flags};
+    append(LOG_LOOP, now, p, sizeof(p));
+}
+
+void ActionLog::seed(unsigned long now, uint32_t seed) {
+    uint8_t p[5];
+    append(LOG_SEED, now, p, putVarint(p, seed));
+}
+
+void ActionLog::state(unsigned long now, uint32_t digest) {
+    uint8_t p[4];
+    putU32(p, digest);
+    append(LOG_STATE, now, p, sizeof(p));
+}
+
+void ActionLog::resume(unsigned long now, uint32_t snapshotCrc) {
+    uint8_t p[4];
+    putU32(p, snapshotCrc);
+    append(LOG_RESUME, now, p, sizeof(p));
+}
+
+void ActionLog::checkpoint(unsigned long now, const uint8_t* data, size_t len) {
+    size_t parts = (len + CHECKPOINT_CHUNK - 1) / CHECKPOINT_CHUNK;
+    if (parts == 0 || parts > 255) return;
+    uint8_t p[2 + CHECKPOINT_CHUNK];
+    for (size_t i = 0; i < parts; i++) {
+        size_t n = std::min(CHECKPOINT_CHUNK, len - i * CHECKPOINT_CHUNK);
+        p[0] = (uint8_t)i; p[1] = (uint8_t)parts;
+        memcpy(p + 2, data + i * CHECKPOINT_CHUNK, n);
+        append(LOG_CHECKPOINT, now, p, n + 2);
+    }
+}
+
+void ActionLog::append(uint8_t type, unsigned long now, const uint8_t* payload, size_t len) {
+    if (!enabled) return;
+    uint8_t rec[2 + 5 + 2 + CHECKPOINT_CHUNK];
+    size_t n = 2;
+    n += putVarint(rec + n, zigzag((int32_t)((uint32_t)now - lastTime)));
+    if (n + len > sizeof(rec)) return;
+    memcpy(rec + n, payload, len);
+    n += len;
+    rec[0] = (uint8_t)(n - 1); rec[1] = type;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (head == tail) tailTime = (uint32_t)now; // 緩衝為空：此筆即為最舊紀錄
+    // 空間不足：整筆丟棄最舊紀錄，並把 tailTime 推進到下一筆
+    while (CAPACITY - (head - tail) < n) {
+        tail += 1 + buf[tail % CAPACITY];
+        dropped++;
+        if (tail == head) { tailTime = (uint32_t)now; break; }
+        uint32_t dt = 0;
+        for (int shift = 0, i = 2; shift < 35; shift += 7, i++) {
+            uint8_t b = buf[(tail + i) % CAPACITY];
+            dt |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        tailTime += unzigzag(dt);
+    }
+    for (size_t i = 0; i < n; i++) buf[(head + i) % CAPACITY] = rec[i];
+    head += n;
+    lastTime = (uint32_t)now;
+    records++;
+}
+
+// --- 匯出 ---
+
+size_t ActionLog::beginExport(Export& e) {
+    std::lock_guard<std::mutex> guard(lock);
+    memcpy(e.header, "WWLG", 4);
+    e.from = tail; e.to = head;
+    uint32_t body = e.to - e.from;
+    e.header[4] = VERSION; e.header[5] = (uint8_t)body; e.header[6] = (uint8_t)(body >> 8); e.header[7] = (uint8_t)(body >> 16);
+    putU32(e.header + 8, dropped);
+    putU32(e.header + 12, tailTime);
+    return HEADER_LEN + (e.to - e.from);
+}
+
+size_t ActionLog::exportRead(const Export& e, size_t offset, uint8_t* dst, size_t len) {
+    size_t copied = 0;
+    if (offset < HEADER_LEN) {
+        copied = std::min(len, HEADER_LEN - offset);
+        memcpy(dst, e.header + offset, copied);
+        offset += copied;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t pos = e.from + (uint32_t)(offset - HEADER_LEN);
+    if ((int32_t)(pos - tail) < 0) return 0; // 匯出途中已被覆蓋
+    while (copied < len && pos != e.to) dst[copied++] = buf[pos++ % CAPACITY];
+    return copied;
+}
+
+void ActionLog::dump(std::string& out) {
+    Export e;
+    out.resize(beginExport(e));
+    out.resize(exportRead(e, 0, (uint8_t*)&out[0], out.size()));
+}
+
+// --- 解碼 ---
+
+bool LogReader::readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool LogReader::readId(const uint8_t*& p, const uint8_t* end, int& seat, char* literal) {
+    literal[0] = '\0'; seat = -1;
+    if (p >= end) return false;
+    uint8_t tag = *p++;
+    if (tag != ID_LITERAL) { seat = (int)tag - 1; return true; }
+    if (p >= end || *p >= PlayerTable::ID_LEN || end - p < 1 + *p) return false;
+    size_t n = *p++;
+    memcpy(literal, p, n); literal[n] = '\0';
+    p += n;
+    return true;
+}
+
+bool LogReader::open(const uint8_t* data, size_t len) {
+    if (len < ActionLog::HEADER_LEN || memcmp(data, "WWLG", 4) != 0 || data[4] == 0 || data[4] > ActionLog::VERSION) return false;
+    auto u32 = [data](int at) { return (uint32_t)data[at] | (uint32_t)data[at + 1] << 8 | (uint32_t)data[at + 2] << 16 | (uint32_t)data[at + 3] << 24; };
+    dropped = u32(8);
+    time = u32(12);
+    expected = data[5] | (uint32_t)data[6] << 8 | (uint32_t)data[7] << 16;
+    truncated = expected && expected != len - ActionLog::HEADER_LEN;
+    if (truncated) return false;
+    p = data + ActionLog::HEADER_LEN; end = data + len;
+    first = true;
+    return true;
+}
+
+bool LogReader::next(LogEntry& e) {
+    if (p >= end || end - p < 1 + *p || *p < 2) return false;
+    const uint8_t* rec = p + 1;
+    const uint8_t* recEnd = rec + *p;
+    p = recEnd;
+    e.type = *rec++;
+    uint32_t dt;
+    if (!readVarint(rec, recEnd, dt)) return false;
+    if (!first) time += unzigzag(dt); // 第一筆的時間差相對於已丟棄的紀錄，以 header 為準
+    first = false;
+    e.time = time;
+    e.payload = rec;
+    e.len = recEnd - rec;
+    return true;
+}
@@ -0,0 +1,67 @@
+#include "audio_queue.h"
+
+bool AudioQueue::push(int track, unsigned long timeoutMs, int followUp, int arg) {
+    if (size == CAPACITY && !(followUp && evictPlain())) {
+        dropped++; // 本段被捨棄 (擠掉他段時由 evictPlain() 計入被擠掉的一段)
+        return false;
+    }
+    AudioCue& c = cues[(head + size) % CAPACITY];
+    c.track = track; c.timeoutMs = timeoutMs; c.followUp = followUp; c.arg = arg;
+    size++;
+    return true;
+}
+
+// 移除最舊一段沒有附帶轉移的待播語音，後面的依序往前
+bool AudioQueue::evictPlain() {
+    for (int i = 0; i < size; i++) {
+        if (cues[(head + i) % CAPACITY].followUp) continue;
+        for (int j = i; j < size - 1; j++) cues[(head + j) % CAPACITY] = cues[(head + j + 1) % CAPACITY];
+        size--;
+        dropped++;
+        return true;
+    }
+    return false;
+}
+
+bool AudioQueue::poll(AudioCue& done) {
+    unsigned long now = clock.millis();
+    if (playing) {
+        unsigned long elapsed = now - startedAt;
+        if (elapsed < SETTLE_MS) return false;          // 指令剛送出，BUSY 尚未反應
+        if (out.isBusy()) {
+            if (elapsed < current.timeoutMs) return false;
+            timeouts++;
+        }
+        playing = false; finished++;
+        if (current.followUp) { done = current; return true; }
+    }
+    if (size > 0) {
+        waiting = !out.ready();
+        if (waiting) return false;                      // 多桌共用喇叭：等其他桌這段播完
+        current = cues[head];
+        head = (head + 1) % CAPACITY; size--;
+        out.play(current.track);
+        startedAt = now; playing = true; played++;
+    }
+    return false;
+}
+
+unsigned long AudioQueue::nextPollIn(unsigned long now, unsigned long pollMs) const {
+    if (!playing) return size == 0 ? NO_POLL : waiting ? pollMs : 0;
+    unsigned long elapsed = now - startedAt;
+    if (elapsed < SETTLE_MS) return SETTLE_MS - elapsed;
+    if (!out.wakesOnIdle()) return pollMs;
+    return elapsed < current.timeoutMs ? current.timeoutMs - elapsed : 0; // BUSY 轉閒由中斷喚醒，只需顧及逾時
+}
+
+void AudioQueue::restore(bool isPlaying, const AudioCue& cue, unsigned long since, const AudioCue* queued, int n) {
+    playing = isPlaying; current = cue; startedAt = since;
+    head = 0; size = n < CAPACITY ? n : CAPACITY;
+    for (int i = 0; i < size; i++) cues[i] = queued[i];
+    waiting = false;
+}
+
+void AudioQueue::clear() {
+    size = 0;
+    current.followUp = 0;
+}
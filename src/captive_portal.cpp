@@ -0,0 +1,65 @@
+#include "captive_portal.h"
+#include <string.h>
+
+// Android 各廠牌 (含 Chrome OS) 皆沿用 generate_204；Windows 另有 NCSI 與瀏覽器導向網址
+const CaptiveProbe CAPTIVE_PROBES[] = {
+    {"/generate_204",              CAPTIVE_REDIRECT, "android"},
+    {"/gen_204",                   CAPTIVE_REDIRECT, "android"},
+    {"/hotspot-detect.html",       CAPTIVE_LANDING,  "apple"},
+    {"/library/test/success.html", CAPTIVE_LANDING,  "apple"},
+    {"/connecttest.txt",           CAPTIVE_REDIRECT, "windows"},
+    {"/ncsi.txt",                  CAPTIVE_REDIRECT, "windows"},
+    {"/redirect",                  CAPTIVE_REDIRECT, "windows"},
+    {"/fwlink/",                   CAPTIVE_REDIRECT, "windows"},
+    {"/canonical.html",            CAPTIVE_REDIRECT, "firefox"},
+    {"/success.txt",               CAPTIVE_REDIRECT, "firefox"},
+    {"/kindle-wifi/wifistub.html", CAPTIVE_REDIRECT, "kindle"},
+};
+const int CAPTIVE_PROBE_COUNT = sizeof(CAPTIVE_PROBES) / sizeof(CAPTIVE_PROBES[0]);
+
+// 樣式與遊戲網頁相同；連結用絕對網址，登入視窗外開啟時才會是遊戲本身的來源
+const char CAPTIVE_LANDING_HTML[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+    "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"><title>狼人殺</title><style>"
+    "body{font-family:sans-serif;background:#121212;color:white;text-align:center;margin:0;padding:10px}"
+    ".card{background:#1e1e1e;padding:20px;border-radius:15px;max-width:400px;margin:10px auto;border:1px solid #333}"
+    "a{display:block;background:#2563eb;color:white;padding:15px;border-radius:10px;margin:8px 0;"
+    "font-size:16px;font-weight:bold;text-decoration:none}.info{color:#facc15}"
+    "</style></head><body><div class=\"card\"><h2>狼人殺</h2>"
+    "<a href=\"" CAPTIVE_ORIGIN "/\">進入遊戲</a>"
+    "<p class=\"info\">若在「登入網路」視窗中開啟，請改用瀏覽器前往 " CAPTIVE_ORIGIN
+    "，重新整理後仍會回到原座位。</p></div></body></html>";
+const size_t CAPTIVE_LANDING_LEN = sizeof(CAPTIVE_LANDING_HTML) - 1;
+
+// --- DNS ---
+
+size_t dnsReply(const uint8_t* q, size_t len, const uint8_t ip[4], uint8_t* out, size_t cap) {
+    if (len < 12 || (q[2] & 0x80) || (q[2] & 0x78)) return 0;   // 必須是查詢 (QR=0) 且 opcode = 0
+    if (!(q[4] | q[5])) return 0;                             // 沒有問題
+    size_t pos = 12;
+    for (;;) {                                                // 第一個問題的名稱
+        if (pos >= len) return 0;
+        uint8_t l = q[pos];
+        if (l == 0) { pos++; break; }
+        if (l & 0xC0) return 0;                               // 問題內不應有壓縮指標
+        pos += l + 1;
+    }
+    if (pos + 4 > len) return 0;
+    uint16_t type = q[pos] << 8 | q[pos + 1];
+    uint16_t cls = q[pos + 2] << 8 | q[pos + 3];
+    size_t qend = pos + 4;
+    bool answer = (type == 1 || type == 255) && (cls == 1 || cls == 255); // A / ANY
+    if (qend + (answer ? 16 : 0) > cap) return 0;
+
+    memcpy(out, q, qend);                                     // ID 與問題原樣帶回
+    out[2] = 0x84 | (q[2] & 0x01);                            // QR + AA，保留 RD
+    out[3] = 0x00;                                            // RCODE = 0 (AAAA 等回答無紀錄)
+    out[4] = 0; out[5] = 1;
+    out[6] = 0; out[7] = answer;
+    memset(out + 8, 0, 4);                                    // NS / AR (EDNS 不回)
+    if (!answer) return qend;
+    static const uint8_t RR[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4}; // 指向問題名稱、A、IN、TTL 60 秒
+    memcpy(out + qend, RR, sizeof(RR));
+    memcpy(out + qend + sizeof(RR), ip, 4);
+    return qend + 16;
+}
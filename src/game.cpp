@@ -0,0 +1,1164 @@
+/*
+ * =============================================================
+ * 狼人殺遊戲引擎 - 規則、階段流程與狀態同步
+ * -------------------------------------------------------------
+ * 由 main.cpp 抽出；不直接接觸任何硬體，全部經由 Hal。
+ * =============================================================
+ */
+
+#include "game.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+WerewolfGame::WerewolfGame(Hal& hal) : hal(hal), audio(hal.audio, hal.clock), oledRenderer(hal.display, hal.clock),
+                                      snapshots(hal.sys) {
+    metricsText.reserve(Metrics::SNAPSHOT_RESERVE);
+}
+
+// 語音一律排入佇列依序播放，不在此等待 (指令穩定時間由 AudioQueue 處理)
+void WerewolfGame::playVoice(int fileID, unsigned long timeoutMs, CueEvent followUp, int arg) {
+    hal.sys.log("Audio: Queue #%d\n", fileID);
+    if (audio.push(fileID, timeoutMs, followUp, arg)) return;
+    hal.sys.log("Audio: queue full, drop #%d\n", fileID);
+    if (followUp) { // 語音可以不播，轉移不能不做 (否則階段停住)
+        AudioCue cue;
+        cue.track = fileID; cue.timeoutMs = timeoutMs; cue.followUp = followUp; cue.arg = arg;
+        onCueDone(cue);
+    }
+}
+
+static const unsigned long OPEN_EYES_MS = 2000;     // 閉眼後至睜眼的間隔
+static const unsigned long SEER_RESULT_MS = 5500;   // 預言家查驗後保留閱讀結果的時間
+static const unsigned long FAKE_TURN_MS = 3000;     // 神職已死時的假回合長度
+static const unsigned long COUNTDOWN_MS = 4000;     // 開局倒數
+static const unsigned long POLL_MS = 10;            // 語音播放中的輪詢間隔
+static const unsigned long IDLE_WAKE_MS = 1000;     // 無事可做時的最長睡眠
+static const unsigned long RETRY_SEND_MS = 50;      // 有 client 等待補送時的檢查間隔
+static const unsigned long BROADCAST_MS = 40;       // 兩次廣播的最短間隔 (每秒最多 25 次)，期間的變化合併送出
+
+// 進入新階段：鎖定介面，排程睜眼
+void WerewolfGame::enterPhase(int phase) {
+    nightPhase = phase;
+    isPhaseLocked = true;
+    timers.arm(TM_OPEN_EYES, hal.clock.millis(), OPEN_EYES_MS);
+}
+
+// 結束 phase：閉眼語音後進入轉移表中的下一階段
+void WerewolfGame::closePhase(int phase) {
+    if (PHASE_TRAITS[phase].closeTrack) playVoice(PHASE_TRAITS[phase].closeTrack);
+    enterPhase(PHASE_TRAITS[phase].next);
+}
+
+// 天黑：開局或白天結束 (放逐、獵人白天開槍) 後進入夜晚
+void WerewolfGame::startNight(bool nextRound) {
+    if (nextRound) {
+        wolfTargetId = -1; witchPoisonId = -1; currentGuardedId = -1; lastNightDeadMask = 0; // V1.5: 進入新夜晚，清空死者名單
+        roundCount++;
+    }
+    playVoice(TRACK_NIGHT); // V1.4 BUGFIX: 進入新夜晚時播放天黑音效
+    // V1.4 MOD: 根據守衛是否存在決定夜晚的起始階段
+    enterPhase(players.isRoleAlive(ROLE_GUARD) ? PHASE_GUARD : PHASE_WOLF);
+}
+
+// --- 投票 ---
+
+// 開票：狼人由存活狼人投，白天由存活、已入座且未翻牌的玩家投
+void WerewolfGame::openVote(VoteKind kind) {
+    PlayerTable::Mask voters = players.aliveMask;
+    if (kind == VOTE_WOLF) {
+        voters &= players.roleMask[ROLE_WOLF];
+    } else {
+        voters &= ~players.revealedMask & ~players.roleMask[ROLE_JOINED] & ~players.roleMask[ROLE_SPECTATOR];
+    }
+    ballot.begin(kind, voters);
+    if (voteRules[kind].timeoutMs) timers.arm(TM_VOTE, hal.clock.millis(), voteRules[kind].timeoutMs);
+    if (ballot.complete()) closeVote(); // 無人有投票權
+}
+
+// 目標須為存活且已入座的玩家；空字串 (-1) 為棄票 / 空刀
+void WerewolfGame::castVote(VoteKind kind, int seat, int target) {
+    if (!ballot.open || ballot.kind != kind || gameOver) return;
+    if (target >= 0 && !(players.index[target] && players.isAlive(target))) return;
+    if (!ballot.vote(seat, target)) return; // 無投票權或已投過
+    if (ballot.complete()) closeVote();
+}
+
+void WerewolfGame::closeVote() {
+    timers.disarm(TM_VOTE);
+    TieRule tie = voteRules[ballot.kind].tie;
+    uint32_t rnd = 0;
+    if (tie == TIE_RANDOM && ballot.tied()) { // 與洗牌相同：種子記入行動紀錄供重播
+        rnd = (uint32_t)hal.sys.random(1, 0x7FFFFFFF);
+        journal.seed(hal.clock.millis(), rnd);
+    }
+    int target = ballot.close(tie, rnd);
+    if (ballot.kind == VOTE_WOLF) {
+        wolfTargetId = target;
+        closePhase(PHASE_WOLF); // 狼人閉眼
+    } else {
+        exile(target);
+    }
+}
+
+// 白天放逐結果 (-1 = 無人出局)
+void WerewolfGame::exile(int exId) {
+    bool hunterExiled = false;
+
+    if (exId >= 0) {
+        if (exId == idiotId && !(players.revealedMask & PlayerTable::bit(exId))) {
+            players.revealedMask |= PlayerTable::bit(exId); // 白痴翻牌免死
+        } else {
+            players.kill(exId);
+            if (players.role[exId] == ROLE_HUNTER && hunterCanShoot) {
+                hunterExiled = true;
+            }
+        }
+    }
+
+    if (hunterExiled) {
+        hunterActionPending = true; // 鎖定UI，等待獵人
+        playVoice(TRACK_HUNTER_CALL);
+    } else {
+        startNight(true); // 進入下一晚
+    }
+}
+
+void WerewolfGame::startCountdown() {
+    isStartingCountdown = true;
+    countdownStartTime = hal.clock.millis();
+    triggerBuzzer(2);
+    timers.arm(TM_COUNTDOWN, countdownStartTime, 1000); // 每秒更新倒數
+}
+
+// 計時器到期
+void WerewolfGame::onTimer(int timer) {
+    unsigned long now = hal.clock.millis();
+    if (timer == TM_COUNTDOWN) {
+        if (!isStartingCountdown) return;
+        unsigned long elapsed = now - countdownStartTime;
+        if (elapsed >= COUNTDOWN_MS) {
+            isStartingCountdown = false;
+            gameStarted = true;
+            startNight(false);
+        } else {
+            timers.arm(TM_COUNTDOWN, now, 1000 - elapsed % 1000);
+        }
+        stateChanged();
+        return;
+    }
+    if (!gameStarted || gameOver) return;
+
+    if (timer == TM_OPEN_EYES) {
+        if (!audio.idle()) { openEyesWaiting = true; return; } // 前一段語音 (含閉眼、天黑) 播完才睜眼，由 loop() 接續
+        playVoice(PHASE_TRAITS[nightPhase].openTrack);
+        isPhaseLocked = false;
+        if (nightPhase == PHASE_WOLF) openVote(VOTE_WOLF);
+        else if (nightPhase == PHASE_DAY) openVote(VOTE_EXILE);
+        stateChanged();
+    } else if (timer == TM_SEER_RESULT) {
+        isSeerCheckPending = false;
+        closePhase(PHASE_SEER);
+        stateChanged();
+    } else if (timer == TM_FAKE_TURN) {
+        // V1.4: 神職已死仍播放閉眼音效完善假回合，播完 (或超時5秒) 後由 onCueDone() 進入下一階段
+        playVoice(PHASE_TRAITS[nightPhase].closeTrack, 5000, CUE_FAKE_TURN_END, nightPhase);
+    } else if (timer == TM_VOTE) {
+        if (ballot.open) closeVote(); // 逾時：未投者視同棄票
+        stateChanged();
+    }
+}
+
+// 語音播完後的狀態轉移
+void WerewolfGame::onCueDone(const AudioCue& cue) {
+    if (cue.followUp == CUE_FAKE_TURN_END) {
+        if (cue.arg == PHASE_WITCH && wolfTargetId >= 0 && wolfTargetId != currentGuardedId) { // 女巫死亡：狼刀直接結算
+            lastNightDeadMask |= PlayerTable::bit(wolfTargetId); // V1.5: 記錄死者
+            players.kill(wolfTargetId);
+        }
+        enterPhase(PHASE_TRAITS[cue.arg].next);
+        stateChanged();
+    }
+}
+
+void WerewolfGame::triggerBuzzer(int type) {
+    if (type == 1) hal.audio.tone(1000, 100);
+    if (type == 2) hal.audio.tone(800, 500);
+}
+
+// 陣營內所有角色的座位
+static PlayerTable::Mask teamSeats(const PlayerTable& t, Team team) {
+    PlayerTable::Mask m = 0;
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        if (teamRoles(team) & (1u << r)) m |= t.roleMask[r];
+    }
+    return m;
+}
+
+void WerewolfGame::checkVictory() {
+    if (!gameStarted || isStartingCountdown || gameOver) return;
+    int wolves = PlayerTable::popcount(players.aliveMask & teamSeats(players, TEAM_WOLVES));
+    int humans = PlayerTable::popcount(players.aliveMask & teamSeats(players, TEAM_HUMANS));
+
+    if (wolves == 0) winner = TEAM_HUMANS;
+    else if (wolves >= humans) winner = TEAM_WOLVES;
+    else return;
+    gameOver = true; // 之後不再檢查，確保只觸發一次
+    playVoice(TEAM_TRAITS[winner].winTrack); // V1.5: 播放勝利音效
+}
+
+void WerewolfGame::setupRoles() {
+    int seq = 1;
+    idiotId = -1; players.revealedMask = 0; hunterCanShoot = true;
+
+    // 動態配制角色池 (依人數門檻，見 RolePool::standard())
+    Role rPool[PlayerTable::CAPACITY];
+    int poolSize = rolePool.deal(targetPlayerCount, rPool, PlayerTable::CAPACITY);
+
+    // 洗牌：只向系統取一次種子並記入行動紀錄，重播時即可重現相同的角色分配
+    uint32_t rng = (uint32_t)hal.sys.random(1, 0x7FFFFFFF);
+    journal.seed(hal.clock.millis(), rng);
+    for(int i = poolSize - 1; i > 0; i--) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; // xorshift32
+        int j = rng % (i + 1); std::swap(rPool[i], rPool[j]);
+    }
+
+    // 依加入順序入座；超過設定人數者轉為旁觀
+    int rIdx = 0;
+    for (int seat = 0; seat < players.count; seat++) {
+        if (players.role[seat] == ROLE_SPECTATOR) continue;
+        if (rIdx >= poolSize) {
+            players.setRole(seat, ROLE_SPECTATOR); players.index[seat] = 0;
+            continue;
+        }
+        players.index[seat] = seq++;
+        players.setRole(seat, rPool[rIdx++]);
+        if(players.role[seat] == ROLE_IDIOT) idiotId = seat;
+    }
+}
+
+void WerewolfGame::resetGame() {
+    hal.sys.log("DEBUG: resetGame() called.\n");
+    gameStarted = false; gameOver = false; isStartingCountdown = false;
+    adminApprovedReset = false; winner = TEAM_NONE;
+    nightPhase = PHASE_NONE;
+    roundCount = 1;
+    players.aliveMask = players.usedMask(); lastNightDeadMask = 0; players.votedMask = 0; confirmPressed = false;
+    for (int seat = 0; seat < players.count; seat++) { if (players.role[seat] != ROLE_SPECTATOR) players.setRole(seat, ROLE_JOINED); }
+    wolfTargetId = -1; witchPoisonId = -1; witchHasHeal = true; witchHasPoison = true;
+    lastGuardedId = -1; currentGuardedId = -1; hunterCanShoot = true; players.revealedMask = 0;
+    isPhaseLocked = false; isSeerCheckPending = false; ballot.open = false;
+    hunterActionPending = false; // 上一局結束時可能仍在等待獵人或假回合
+    timers.clear(); openEyesWaiting = false;
+    audio.clear();
+    reclaimSeats(); // 已離線的玩家不再佔用下一局的座位與角色
+}
+
+// 大廳中 (未開局、未倒數) 釋放沒有連線的已加入與旁觀座位，回傳釋放數；
+// 開局後座位保留，斷線的玩家以同一 deviceId 重新連線即回到原座位
+int WerewolfGame::reclaimSeats() {
+    if (gameStarted || isStartingCountdown) return 0;
+    PlayerTable::Mask live = localSeats;
+    for (auto& cp : clients) live |= PlayerTable::bit(cp.second.seat);
+    return releaseSeats(players.usedMask() & ~live &
+                        (players.roleMask[ROLE_JOINED] | players.roleMask[ROLE_SPECTATOR]));
+}
+
+// 釋放指定座位並壓縮座位表，所有以座位編號記錄的狀態一併換成新編號；回傳釋放數
+int WerewolfGame::releaseSeats(PlayerTable::Mask drop) {
+    if (!drop) return 0;
+
+    currentPlayerCount -= PlayerTable::popcount(drop & players.roleMask[ROLE_JOINED]);
+    int8_t moved[PlayerTable::CAPACITY];
+    players.release(drop, moved);
+    for (auto& cp : clients) cp.second.seat = moved[cp.second.seat];
+    localSeats = PlayerTable::remap(localSeats, moved);
+    lastNightDeadMask = PlayerTable::remap(lastNightDeadMask, moved);
+    for (int* s : {&wolfTargetId, &witchPoisonId, &lastGuardedId, &currentGuardedId, &idiotId}) {
+        *s = PlayerTable::remap(*s, moved);
+    }
+    ballot.cast = ballot.eligible = 0; // 大廳中不會有進行中的投票；接續時由本階段重新開票
+    lastTargetsMask = 0; targetsVersion++; // 座位編號已改變，目標名單重送
+    return PlayerTable::popcount(drop);
+}
+
+// --- 狀態同步 ---
+
+// 狀態變動後立即結算規則並記入行動紀錄；送出則標記待廣播，由 loop() 合併後送出
+void WerewolfGame::stateChanged() {
+    stats.stateChanges++;
+    checkVictory();
+
+    // 自動跳過無人職位 (V1.4 - 增加延遲)
+    if (gameStarted && !gameOver && !isPhaseLocked && !timers.armed(TM_FAKE_TURN) && !hunterActionPending) {
+        Role actor = PHASE_TRAITS[nightPhase].actor;
+        if (actor != ROLE_COUNT && actor != ROLE_WOLF && !players.isRoleAlive(actor)) {
+            timers.arm(TM_FAKE_TURN, hal.clock.millis(), FAKE_TURN_MS);
+            isPhaseLocked = true; // 鎖定介面，顯示「天黑請閉眼」
+        }
+    }
+
+    dirty = true;
+    // 快照只在開局後的階段轉移 (含倒數、獵人待開槍與結束) 排定；大廳的加入、離開與人數調整不寫，
+    // 設定人數於主控確認時另外寫一次 (見 onInput())，以免磨損非揮發儲存
+    uint32_t phase = gameStarted | isStartingCountdown << 1 | gameOver << 2 | hunterActionPending << 3 |
+                     (uint8_t)nightPhase << 4 | (uint32_t)roundCount << 12;
+    if ((gameStarted || isStartingCountdown) && phase != snapshotPhase) snapshotPending = true;
+    snapshotPhase = phase;
+    if (journal.isEnabled()) journal.state(hal.clock.millis(), stateDigest());
+}
+
+// 廣播：上次廣播後的所有變化合併為每個 client 一個訊框
+void WerewolfGame::broadcast() {
+    dirty = false;
+    lastBroadcast = hal.clock.millis();
+    // V1.8 Memory-Debug: 每次同步取樣剩餘記憶體 (經 /metrics 查看，不再逐次印出)
+    stats.syncs++;
+    stats.heapFree = hal.sys.freeHeap();
+    stats.heapMinFree = hal.sys.minFreeHeap();
+    stats.heapLargestBlock = hal.sys.largestFreeBlock();
+
+    PlayerTable::Mask targetsMask = 0;
+    for (int seat = 0; seat < players.count; seat++) {
+        if (players.index[seat] && players.isAlive(seat)) targetsMask |= PlayerTable::bit(seat);
+    }
+    if (targetsMask != lastTargetsMask) { lastTargetsMask = targetsMask; targetsVersion++; }
+
+    cdSec = (isStartingCountdown) ? std::max(0, (int)(3 - (hal.clock.millis() - countdownStartTime) / 1000)) : 0;
+
+    // V1.5: 產生昨晚死亡報告 (所有玩家相同，只組一次)
+    char note[sizeof(deathNote)] = "";
+    if (nightPhase == PHASE_DAY) {
+        if (lastNightDeadMask == 0) {
+            strcpy(note, "昨晚是平安夜。");
+        } else {
+            size_t n = snprintf(note, sizeof(note), "昨晚死亡的玩家是：");
+            const char* sep = "";
+            for (int seat = 0; seat < players.count && n < sizeof(note); seat++) {
+                if (!(lastNightDeadMask & PlayerTable::bit(seat))) continue;
+                n += snprintf(note + n, sizeof(note) - n, "%s%d號", sep, players.index[seat]);
+                sep = "、";
+            }
+            if (n < sizeof(note)) snprintf(note + n, sizeof(note) - n, "。");
+        }
+    }
+    if (strcmp(note, deathNote) != 0) { strcpy(deathNote, note); deathNoteVersion++; }
+
+    stateVersion++;
+
+    // 除玩家號碼外，update 內容只取決於角色、生死與翻牌狀態以及 client 持有的版本：
+    // 相同組合只序列化一次，再以共用緩衝送給所有同類 client
+    unsigned long syncStart = hal.clock.micros();
+    unsigned long serializeUs = 0;
+    deferredClients = 0;
+    for (auto& cp : clients) {
+        // 背壓：待送佇列已滿的 client 這次略過，累積的變化於佇列有空間時合併為一個差量 (flushDeferred)
+        if (!hal.transport.canSend(cp.first)) {
+            cp.second.deferred = true;
+            deferredClients++;
+            stats.syncDeferred++;
+            continue;
+        }
+        serializeUs += syncClient(cp.first, cp.second);
+    }
+    for (int i = 0; i < frameCacheUsed; i++) hal.transport.releaseShared(frameCache[i].frame);
+    frameCacheUsed = 0;
+    stats.syncSerializeUs.record(serializeUs);
+    stats.syncBroadcastUs.record(hal.clock.micros() - syncStart - serializeUs);
+
+    // OLED 顯示：只發布 view model，實際繪製由 OledRenderer 在繪製工作中進行
+    // 旁觀者頻道：每次同步最多序列化一次，與旁觀人數無關
+    if (hal.transport.watchers(watchChannel()) > 0) publishWatch();
+
+    OledView ov;
+    ov.room = roomNumber;
+    ov.targetCount = targetPlayerCount;
+    ov.currentCount = currentPlayerCount;
+    if (isStartingCountdown) {
+        ov.screen = OledView::COUNTDOWN;
+        ov.countdown = cdSec;
+    } else if (gameOver) {
+        ov.screen = OledView::GAME_OVER;
+        ov.humansWon = (winner == TEAM_HUMANS);
+        ov.adminApproved = adminApprovedReset;
+        ov.readyCount = PlayerTable::popcount(players.votedMask);
+    } else if (!gameStarted) {
+        ov.screen = confirmPressed ? OledView::WAITING : OledView::SETUP;
+    } else {
+        ov.screen = OledView::PLAYING;
+        ov.round = roundCount;
+        ov.nightPhase = nightPhase;
+    }
+    oledRenderer.publish(ov);
+}
+
+// 規則狀態指紋 (FNV-1a)：不含時間、連線與廣播次數，相同輸入序列必得相同結果
+uint32_t WerewolfGame::stateDigest() const {
+    uint32_t h = 2166136261u;
+    auto mix = [&h](uint32_t v) {
+        for (int i = 0; i < 4; i++) { h ^= (v >> (8 * i)) & 0xFF; h *= 16777619u; }
+    };
+    mix(gameStarted | isStartingCountdown << 1 | confirmPressed << 2 | gameOver << 3 | adminApprovedReset << 4 |
+        isPhaseLocked << 5 | isSeerCheckPending << 6 | hunterActionPending << 7 | witchHasHeal << 8 |
+        witchHasPoison << 9 | hunterCanShoot << 10 | (uint32_t)winner << 16);
+    mix(nightPhase); mix(roundCount); mix(targetPlayerCount); mix(currentPlayerCount);
+    mix(wolfTargetId); mix(witchPoisonId); mix(lastGuardedId); mix(currentGuardedId); mix(idiotId);
+    mix(players.count); mix(players.aliveMask); mix(players.revealedMask); mix(players.votedMask);
+    mix(lastNightDeadMask);
+    mix(ballot.open | ballot.kind << 1); mix(ballot.cast);
+    for (int seat = 0; seat < players.count; seat++) mix(players.role[seat] | players.index[seat] << 8);
+    return h;
+}
+
+// 各欄位指紋：內容相同則指紋相同；選填欄位不存在時為 0
+void WerewolfGame::fillView(int seat, uint32_t* v) {
+    Role role = players.roleOf(seat);
+    bool alive = players.isAlive(seat);
+    bool witchView = nightPhase == PHASE_WITCH && role == ROLE_WITCH;
+    v[UF_ROLE] = role;
+    v[UF_IS_DEAD] = !alive;
+    v[UF_PHASE] = (uint32_t)nightPhase;
+    v[UF_GAME_OVER] = gameOver;
+    v[UF_WINNER] = winner;
+    v[UF_ADMIN_APPROVED] = adminApprovedReset;
+    v[UF_TARGETS] = targetsVersion;
+    v[UF_PHASE_LOCKED] = isPhaseLocked || hunterActionPending;
+    v[UF_HUNTER_PENDING] = hunterActionPending;
+    v[UF_COUNTDOWN] = cdSec;
+    v[UF_IS_STARTING] = isStartingCountdown;
+    v[UF_IDIOT_REVEALED] = (players.revealedMask & PlayerTable::bit(seat)) != 0;
+    v[UF_WAITING] = (!gameStarted && confirmPressed && !isStartingCountdown);
+    v[UF_CURRENT_COUNT] = currentPlayerCount;
+    v[UF_TARGET_COUNT] = targetPlayerCount;
+    v[UF_VOTED] = (gameOver && adminApprovedReset) ? players.votedMask : 0;
+    v[UF_CAN_SHOOT] = (role == ROLE_HUNTER && !alive && hunterCanShoot);
+    v[UF_DEATH_NOTE] = (nightPhase == PHASE_DAY) ? deathNoteVersion : 0;
+    v[UF_LAST_GUARDED] = (nightPhase == PHASE_GUARD && role == ROLE_GUARD) ? lastGuardedId + 2 : 0;
+    v[UF_HAS_HEAL] = witchView ? witchHasHeal + 1 : 0;
+    v[UF_HAS_POISON] = witchView ? witchHasPoison + 1 : 0;
+    v[UF_WOLF_TARGET] = witchView ? wolfTargetId + 2 : 0;
+    // 投票進度：已投票名單與有投票權人數；狼人投票只讓狼人看到
+    v[UF_BALLOTS] = 0;
+    if (ballot.open && (ballot.kind == VOTE_EXILE || role == ROLE_WOLF)) {
+        uint32_t h = 2166136261u;
+        for (uint32_t x : {ballot.cast, ballot.eligible, (uint32_t)ballot.kind}) { h ^= x; h *= 16777619u; }
+        v[UF_BALLOTS] = h | 1;
+    }
+}
+
+// mask 為 0 時輸出完整快照 (type=update)，否則只輸出 mask 內的欄位 (type=delta)
+void WerewolfGame::writeUpdate(JsonDocument& m, int seat, uint32_t mask, uint32_t base, bool binary) {
+    Role role = players.roleOf(seat);
+    bool alive = players.isAlive(seat);
+    bool full = (mask == 0);
+    if (full) mask = ~0u;
+    uint32_t view[UF_COUNT];
+    fillView(seat, view);
+    // 選填欄位：快照中省略，差量中以預設值清除
+    auto want = [&](int f) { return (mask & (1u << f)) && (!full || view[f] != 0); };
+    auto K = [binary](WireKey k) { return wireKey(k, binary); };
+
+    m[K(K_TYPE)] = msgType(full ? MSG_UPDATE : MSG_DELTA, binary);
+    if (!full) m[K(K_BASE)] = base;
+    m[K(K_VERSION)] = stateVersion;
+    if (mask & (1u << UF_ROLE)) {
+        if (binary) m[K(K_ROLE)] = (int)role; // 二進位模式以角色代碼取代中文名稱
+        else m[K(K_ROLE)] = roleName(role);
+    }
+    if (mask & (1u << UF_IS_DEAD)) m[K(K_IS_DEAD)] = !alive;
+    if (mask & (1u << UF_PHASE)) m[K(K_PHASE)] = nightPhase;
+    if (mask & (1u << UF_GAME_OVER)) m[K(K_GAME_OVER)] = gameOver;
+    if (mask & (1u << UF_WINNER)) m[K(K_WINNER)] = teamName(winner);
+    if (mask & (1u << UF_ADMIN_APPROVED)) m[K(K_ADMIN_APPROVED)] = adminApprovedReset;
+    if (mask & (1u << UF_TARGETS)) {
+        JsonArray targets = m.createNestedArray(K(K_TARGETS));
+        for (int s = 0; s < players.count; s++) {
+            if (!(lastTargetsMask & PlayerTable::bit(s))) continue;
+            JsonObject obj = targets.createNestedObject();
+            obj[K(K_ID)] = players.idOf(s); obj[K(K_INDEX)] = players.index[s];
+        }
+    }
+    if (mask & (1u << UF_PHASE_LOCKED)) m[K(K_PHASE_LOCKED)] = isPhaseLocked || hunterActionPending;
+    if (mask & (1u << UF_HUNTER_PENDING)) m[K(K_HUNTER_PENDING)] = hunterActionPending;
+    if (mask & (1u << UF_COUNTDOWN)) m[K(K_COUNTDOWN)] = cdSec;
+    if (mask & (1u << UF_IS_STARTING)) m[K(K_IS_STARTING)] = isStartingCountdown;
+    if (mask & (1u << UF_IDIOT_REVEALED)) m[K(K_IDIOT_REVEALED)] = view[UF_IDIOT_REVEALED] != 0;
+
+    // V1.6: 新增等待玩家狀態標記與計數
+    if (mask & (1u << UF_WAITING)) m[K(K_WAITING)] = view[UF_WAITING] != 0;
+    if (mask & (1u << UF_CURRENT_COUNT)) m[K(K_CURRENT_COUNT)] = currentPlayerCount;
+    if (mask & (1u << UF_TARGET_COUNT)) m[K(K_TARGET_COUNT)] = targetPlayerCount;
+
+    // V1.4 BUGFIX: 傳送續局投票者列表
+    if (mask & (1u << UF_VOTED)) {
+        JsonArray votedPlayers = m.createNestedArray(K(K_VOTED));
+        for (int s = 0; s < players.count; s++) {
+            if (view[UF_VOTED] & PlayerTable::bit(s)) votedPlayers.add(players.idOf(s));
+        }
+    }
+
+    // 獵人開槍判斷
+    if (mask & (1u << UF_CAN_SHOOT)) m[K(K_CAN_SHOOT)] = view[UF_CAN_SHOOT] != 0;
+
+    if (want(UF_DEATH_NOTE)) m[K(K_DEATH_NOTE)] = view[UF_DEATH_NOTE] ? (const char*)deathNote : "";
+    if (want(UF_LAST_GUARDED)) m[K(K_LAST_GUARDED)] = players.idOf(lastGuardedId);
+    if (want(UF_HAS_HEAL)) m[K(K_HAS_HEAL)] = view[UF_HAS_HEAL] && witchHasHeal;
+    if (want(UF_HAS_POISON)) m[K(K_HAS_POISON)] = view[UF_HAS_POISON] && witchHasPoison;
+    if (want(UF_WOLF_TARGET)) {
+        bool shown = view[UF_WOLF_TARGET] != 0;
+        m[K(K_WOLF_TARGET_INDEX)] = (shown && wolfTargetId >= 0) ? players.index[wolfTargetId] : 0;
+        m[K(K_WOLF_TARGET_ID)] = shown ? players.idOf(wolfTargetId) : "";
+    }
+    if (want(UF_BALLOTS)) {
+        bool shown = view[UF_BALLOTS] != 0;
+        JsonArray ballots = m.createNestedArray(K(K_BALLOTS));
+        for (int s = 0; shown && s < players.count; s++) {
+            if (ballot.cast & PlayerTable::bit(s)) ballots.add(players.index[s]);
+        }
+        m[K(K_VOTERS)] = shown ? PlayerTable::popcount(ballot.eligible) : 0;
+    }
+}
+
+void WerewolfGame::sendDoc(uint32_t clientId, JsonDocument& doc, bool binary) {
+    char buf[128];
+    size_t n = binary ? serializeMsgPack(doc, buf, sizeof(buf)) : serializeJson(doc, buf, sizeof(buf));
+    hal.transport.send(clientId, buf, n, binary);
+}
+
+// 送出單一 client 的玩家號碼與快照/差量，回傳序列化耗時 (微秒)
+unsigned long WerewolfGame::syncClient(uint32_t clientId, ClientSession& cs) {
+    unsigned long serializeUs = 0;
+    int seat = cs.seat;
+    cs.deferred = false;
+    if (players.index[seat] != cs.sentIndex) {
+        StaticJsonDocument<96> seatMsg;
+        seatMsg[wireKey(K_TYPE, cs.binary)] = msgType(MSG_SEAT, cs.binary);
+        seatMsg[wireKey(K_INDEX, cs.binary)] = players.index[seat];
+        if (roomNumber) { // 多桌：告知所在桌號與桌數，供網頁選桌
+            seatMsg[wireKey(K_ROOM, cs.binary)] = roomNumber;
+            seatMsg[wireKey(K_ROOMS, cs.binary)] = roomCount;
+        }
+        sendDoc(clientId, seatMsg, cs.binary);
+        cs.sentIndex = players.index[seat];
+    }
+
+    uint32_t view[UF_COUNT];
+    fillView(seat, view);
+    uint32_t mask = 0;
+    if (cs.synced) {
+        for (int i = 0; i < UF_COUNT; i++) {
+            if (view[i] != cs.sentView[i]) mask |= 1u << i;
+        }
+        if (mask == 0) return 0; // 沒有變化，不送
+    }
+
+    int variant = (view[UF_ROLE] << 2) | (view[UF_IS_DEAD] << 1) | view[UF_IDIOT_REVEALED];
+    uint32_t base = cs.synced ? cs.sentVersion : 0;
+    FrameSlot* slot = nullptr;
+    for (int i = 0; i < frameCacheUsed; i++) {
+        FrameSlot& fs = frameCache[i];
+        if (fs.variant == variant && fs.mask == mask && fs.base == base && fs.binary == cs.binary) { slot = &fs; break; }
+    }
+    if (!slot) {
+        unsigned long t0 = hal.clock.micros();
+        JsonDocument& m = updateDoc;
+        m.clear();
+        writeUpdate(m, seat, mask, base, cs.binary);
+        size_t len = cs.binary ? measureMsgPack(m) : measureJson(m);
+        if (frameCacheUsed < FRAME_CACHE && hal.transport.makeShared(frameCache[frameCacheUsed].frame, len)) {
+            slot = &frameCache[frameCacheUsed++];
+            slot->variant = variant; slot->mask = mask; slot->base = base; slot->binary = cs.binary;
+            slot->frame.binary = cs.binary;
+            if (cs.binary) serializeMsgPack(m, slot->frame.data, len);
+            else serializeJson(m, slot->frame.data, len + 1);
+        } else { // 快取已滿或無法共用：以預先配置的緩衝個別送出
+            size_t n = cs.binary ? serializeMsgPack(m, frameOut, sizeof(frameOut))
+                                 : serializeJson(m, frameOut, sizeof(frameOut));
+            if (n < len) return serializeUs + hal.clock.micros() - t0; // 超出上限 (不應發生)
+            hal.transport.send(clientId, frameOut, n, cs.binary);
+        }
+        serializeUs += hal.clock.micros() - t0;
+    }
+    if (slot) hal.transport.sendShared(clientId, slot->frame);
+    stats.framesSent++;
+
+    memcpy(cs.sentView, view, sizeof(view));
+    cs.sentVersion = stateVersion;
+    cs.synced = true;
+    return serializeUs;
+}
+
+// 先前因佇列已滿而略過的 client：佇列有空間後送出累積的差量 (不遞增版本，不記入行動紀錄)
+void WerewolfGame::flushDeferred() {
+    deferredClients = 0;
+    for (auto& cp : clients) {
+        if (!cp.second.deferred) continue;
+        if (hal.transport.canSend(cp.first)) syncClient(cp.first, cp.second);
+        else deferredClients++;
+    }
+    for (int i = 0; i < frameCacheUsed; i++) hal.transport.releaseShared(frameCache[i].frame);
+    frameCacheUsed = 0;
+}
+
+// 旁觀者訊框：只含公開資訊 (角色於結束後公開)，內容未變則不送
+void WerewolfGame::publishWatch() {
+    auto K = [](WireKey k) { return wireKey(k, false); };
+    JsonDocument& m = updateDoc;
+    m.clear();
+    m[K(K_TYPE)] = msgType(MSG_WATCH, false);
+    if (roomNumber) m[K(K_ROOM)] = roomNumber;
+    m[K(K_PHASE)] = gameStarted ? nightPhase : PHASE_NONE;
+    m[K(K_ROUND)] = roundCount;
+    m[K(K_IS_STARTING)] = isStartingCountdown;
+    m[K(K_COUNTDOWN)] = cdSec;
+    m[K(K_WAITING)] = (!gameStarted && confirmPressed && !isStartingCountdown);
+    m[K(K_CURRENT_COUNT)] = currentPlayerCount;
+    m[K(K_TARGET_COUNT)] = targetPlayerCount;
+    m[K(K_GAME_OVER)] = gameOver;
+    if (gameOver) m[K(K_WINNER)] = teamName(winner);
+    if (nightPhase == PHASE_DAY) m[K(K_DEATH_NOTE)] = deathNote;
+    JsonArray list = m.createNestedArray(K(K_PLAYERS));
+    for (int seat = 0; seat < players.count; seat++) {
+        if (players.index[seat] == 0 || players.role[seat] == ROLE_SPECTATOR) continue; // 未入座
+        JsonObject p = list.createNestedObject();
+        p[K(K_INDEX)] = players.index[seat];
+        p[K(K_IS_DEAD)] = !players.isAlive(seat);
+        if (gameOver) p[K(K_ROLE)] = roleName(players.role[seat]);
+    }
+    size_t n = serializeJson(m, frameOut, sizeof(frameOut));
+    if (n == 0 || n >= sizeof(frameOut)) return;
+
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) { h ^= (uint8_t)frameOut[i]; h *= 16777619u; }
+    h |= 1;
+    if (h == watchHash) return;
+    watchHash = h;
+    hal.transport.broadcast(watchChannel(), frameOut, n);
+    stats.watchFrames++;
+}
+
+// --- WebSocket 訊息處理 ---
+
+void WerewolfGame::onMessage(uint32_t clientId, const char* d, size_t l, bool binary) {
+    Command cmd;
+    if (parseCommand(clientId, d, l, binary, cmd)) handleCommand(cmd);
+}
+
+void WerewolfGame::handleCommand(const Command& cmd) {
+    uint32_t clientId = cmd.clientId;
+    bool binary = cmd.binary;
+    Action action = cmd.action;
+    const char* devId = cmd.deviceId;
+    if (checkpointPending) writeCheckpoint();
+    int seat = players.find(devId);
+    int targetSeat = players.find(cmd.targetId); // 空字串 (空守/棄票) 為 -1
+    journal.command(hal.clock.millis(), cmd, seat, targetSeat);
+
+    if(action==ACT_CONNECT){
+        if (seat < 0 && (gameStarted || isStartingCountdown)) {
+            // 已發牌：新裝置不入座也不建立同步狀態，請網頁改連旁觀者頻道
+            if (clientId) {
+                StaticJsonDocument<48> go;
+                go[wireKey(K_TYPE, binary)] = msgType(MSG_GO_WATCH, binary);
+                if (roomNumber) go[wireKey(K_ROOM, binary)] = roomNumber;
+                sendDoc(clientId, go, binary);
+            }
+            return;
+        }
+        if(seat < 0){
+            seat = players.intern(devId);
+            if (seat < 0 && reclaimSeats()) seat = players.intern(devId); // 先回收已離線的座位
+            if (seat < 0) { // 座位已滿：明確告知，不讓網頁停在連線中
+                if (clientId) {
+                    StaticJsonDocument<32> full;
+                    full[wireKey(K_TYPE, binary)] = msgType(MSG_FULL, binary);
+                    sendDoc(clientId, full, binary);
+                }
+                return;
+            }
+            players.setRole(seat, ROLE_JOINED);
+            currentPlayerCount++;
+        }
+        if (!clientId) localSeats |= PlayerTable::bit(seat);
+        if (clientId) { // clientId 0：沒有連線的本機玩家 (開發機模擬器)，不建立同步狀態
+            // 重新連線續玩：同一裝置 (deviceId) 的舊連線由新連線接手，不再為它序列化
+            for (auto it = clients.begin(); it != clients.end();) {
+                if (it->first != clientId && it->second.seat == seat) {
+                    hal.transport.close(it->first);
+                    it = clients.erase(it);
+                    stats.sessionsEvicted++;
+                } else {
+                    ++it;
+                }
+            }
+            ClientSession& cs = clients[clientId];
+            cs.seat = seat; cs.sentIndex = -1; cs.synced = false; cs.deferred = false; // 新連線一律送完整快照
+            // 協定協商：網頁以 JSON 送出 connect 並帶 "proto":"mp"，之後改用 MessagePack
+            cs.binary = binary || cmd.wantsMsgPack;
+        }
+        stateChanged();
+    }
+    else if(action==ACT_RESYNC){
+        // client 偵測到版本不連續，要求完整快照
+        auto it = clients.find(clientId);
+        if (it != clients.end()) it->second.synced = false;
+        stateChanged();
+    }
+    else if(action==ACT_DISCONNECT){
+        clients.erase(clientId);
+        if (reclaimSeats()) stateChanged(); // 大廳中離開即讓出座位 (人數減少)；否則其他人看到的內容不變
+    }
+    else if(action==ACT_WATCH){
+        // 旁觀者頻道有新訂閱者：重送目前內容 (共用頻道，其他旁觀者也會收到)
+        watchHash = 0;
+        stateChanged();
+    }
+    else if(action==ACT_RESTART){
+        if (adminApprovedReset && seat >= 0) { // 僅在GM同意後才接受續局投票
+            players.votedMask |= PlayerTable::bit(seat);
+            if(PlayerTable::popcount(players.votedMask) >= targetPlayerCount){
+                // 人數到齊，自動開局
+                resetGame();
+                setupRoles();
+                startCountdown();
+                scheduleCheckpoint();
+            }
+        }
+        stateChanged();
+    }
+    else if (action == ACT_GUARD_PROTECT) {
+        currentGuardedId = targetSeat;
+        lastGuardedId = currentGuardedId; // 更新禁守紀錄
+        closePhase(PHASE_GUARD); // 守衛閉眼
+        stateChanged();
+    }
+    else if (action == ACT_WOLF_KILL) {
+        castVote(VOTE_WOLF, seat, targetSeat); // 全體存活狼人投完才閉眼
+        stateChanged();
+    }
+    else if (action == ACT_SEER_CHECK) {
+        if (isSeerCheckPending) return; // V1.4 BUGFIX: 防止重複查驗
+        if (clientId) {
+            auto it = clients.find(clientId);
+            bool bin = (it != clients.end()) ? it->second.binary : binary;
+            StaticJsonDocument<64> reply;
+            reply[wireKey(K_TYPE, bin)] = msgType(MSG_SEER_RESULT, bin);
+            if (bin) reply[wireKey(K_ROLE, bin)] = (targetSeat >= 0) ? (int)players.role[targetSeat] : -1;
+            else reply[wireKey(K_ROLE, bin)] = (targetSeat >= 0) ? roleName(players.role[targetSeat]) : "";
+            sendDoc(clientId, reply, bin);
+        }
+        isSeerCheckPending = true;
+        timers.arm(TM_SEER_RESULT, hal.clock.millis(), SEER_RESULT_MS);
+        isPhaseLocked = true; // V1.4 BUGFIX: 立即鎖定介面
+        stateChanged();
+    }
+    else if (action == ACT_WITCH_HEAL || action == ACT_WITCH_POISON || action == ACT_WITCH_SKIP) {
+        bool healed = false;
+        if(action == ACT_WITCH_HEAL) {
+            witchHasHeal = false; healed = true;
+        } else if(action == ACT_WITCH_POISON) {
+            witchHasPoison = false;
+            witchPoisonId = targetSeat;
+            if(players.roleOf(witchPoisonId) == ROLE_HUNTER) hunterCanShoot = false; // 毒殺不能開槍
+        }
+
+        // V1.4 - 結算死亡並檢查獵人
+        PlayerTable::Mask newlyDead = 0;
+        if (wolfTargetId >= 0) {
+            if (healed) {
+                if (wolfTargetId == currentGuardedId) newlyDead |= PlayerTable::bit(wolfTargetId); // 同守同救 -> 死
+            } else {
+                if (wolfTargetId != currentGuardedId) newlyDead |= PlayerTable::bit(wolfTargetId);
+            }
+        }
+        if (witchPoisonId >= 0) newlyDead |= PlayerTable::bit(witchPoisonId);
+
+        lastNightDeadMask = newlyDead; // V1.5: 記錄昨晚死者
+        players.aliveMask &= ~newlyDead;
+        bool hunterDiedThisNight = (newlyDead & players.roleMask[ROLE_HUNTER]) && hunterCanShoot;
+
+        playVoice(PHASE_TRAITS[PHASE_WITCH].closeTrack); // 女巫閉眼
+
+        if(hunterDiedThisNight) {
+            hunterActionPending = true; // 鎖定UI，等待獵人行動
+            playVoice(TRACK_HUNTER_CALL);
+        } else {
+            enterPhase(PHASE_TRAITS[PHASE_WITCH].next); // 正常進入白天
+        }
+        stateChanged();
+    }
+    else if (action == ACT_CHAMP_EXILE) {
+        castVote(VOTE_EXILE, seat, targetSeat); // 全員投完 (或逾時) 才結算
+        stateChanged();
+    }
+    else if (action == ACT_HUNTER_SHOOT) {
+        players.kill(targetSeat);
+        hunterCanShoot = false;
+        playVoice(TRACK_HUNTER_SHOT, 3500); // 最多等 3.5 秒
+        triggerBuzzer(2);
+
+        if(hunterActionPending) {
+            hunterActionPending = false;
+            // 判斷獵人死亡的時間點以決定下一階段
+            if(nightPhase == PHASE_DAY) { // 獵人在白天被投票出局，準備進入新夜晚
+                // V1.7 BUGFIX: 槍聲音效須完整播放後才播"天黑"；語音佇列依序播放，不再阻塞等待
+                startNight(true);
+            } else { // 獵人在晚上死亡 (可能是 守/狼/預/巫 階段)
+                enterPhase(PHASE_DAY); // 進入白天階段
+            }
+        }
+        stateChanged();
+    }
+}
+
+// --- 開機初始化 ---
+
+void WerewolfGame::begin() {
+    // --- 強制初始化顯示設定畫面 ---
+    gameStarted = false;
+    isStartingCountdown = false;
+    confirmPressed = false;
+
+    snapshots.begin(roomNumber);
+    resume(); // 當機或斷電前的一局：手機以原 deviceId 重新連線即回到原座位
+
+    lastBroadcast = hal.clock.millis() - BROADCAST_MS;
+    stateChanged(); // 確保開機第一時間顯示 SET PLAYER 畫面 (第一次 loop() 即送出)
+}
+
+// --- 快照 ---
+// 只存規則狀態；投票進度、計時器與語音佇列不存，接續時由本階段重新開始
+
+size_t WerewolfGame::encodeSnapshot(uint8_t* out, size_t cap) const {
+    ByteWriter w(out, cap);
+    w.u8(SNAPSHOT_VERSION);
+    w.u8(gameStarted | isStartingCountdown << 1 | confirmPressed << 2 | gameOver << 3 | adminApprovedReset << 4 |
+         hunterActionPending << 5 | witchHasHeal << 6 | witchHasPoison << 7);
+    w.u8(hunterCanShoot);
+    w.u8(winner); w.u8(nightPhase); w.u8(roundCount); w.u8(targetPlayerCount); w.u8(currentPlayerCount);
+    w.u8(wolfTargetId); w.u8(witchPoisonId); w.u8(lastGuardedId); w.u8(currentGuardedId); w.u8(idiotId); // -1 存為 0xFF
+    w.u32(players.aliveMask); w.u32(players.revealedMask); w.u32(players.votedMask); w.u32(lastNightDeadMask);
+    w.u8(players.count);
+    for (int seat = 0; seat < players.count; seat++) {
+        size_t n = strlen(players.deviceId[seat]);
+        w.u8(players.role[seat]); w.u8(players.index[seat]); w.u8(n);
+        w.bytes(players.deviceId[seat], n);
+    }
+    return w.ok ? w.p - out : 0;
+}
+
+bool WerewolfGame::restoreSnapshot(const uint8_t* data, size_t len) {
+    ByteReader r(data, len);
+    if (r.u8() != SNAPSHOT_VERSION) return false;
+    uint8_t f = r.u8();
+    gameStarted = f & 1; isStartingCountdown = f & 2; confirmPressed = f & 4; gameOver = f & 8;
+    adminApprovedReset = f & 16; hunterActionPending = f & 32; witchHasHeal = f & 64; witchHasPoison = f & 128;
+    hunterCanShoot = r.u8() & 1;
+    winner = (Team)r.u8(); nightPhase = r.i8(); roundCount = r.u8();
+    targetPlayerCount = r.u8(); currentPlayerCount = r.u8();
+    wolfTargetId = r.i8(); witchPoisonId = r.i8(); lastGuardedId = r.i8(); currentGuardedId = r.i8(); idiotId = r.i8();
+    PlayerTable::Mask alive = r.u32(), revealed = r.u32(), voted = r.u32();
+    lastNightDeadMask = r.u32();
+    if (winner >= TEAM_COUNT || nightPhase < PHASE_NONE || nightPhase >= PHASE_COUNT || (gameStarted && nightPhase < 0)) {
+        return false;
+    }
+
+    // 依原順序重新登錄，座位編號與快照相同
+    players = PlayerTable();
+    localSeats = 0;
+    int count = r.u8();
+    for (int seat = 0; seat < count && r.ok; seat++) {
+        uint8_t role = r.u8(), index = r.u8(), n = r.u8();
+        char id[PlayerTable::ID_LEN];
+        if (role >= ROLE_COUNT || n >= sizeof(id) || !r.bytes(id, n)) return false;
+        id[n] = '\0';
+        if (players.intern(id) != seat) return false;
+        players.setRole(seat, (Role)role);
+        players.index[seat] = index;
+    }
+    players.aliveMask = alive; players.revealedMask = revealed; players.votedMask = voted;
+    for (int id : {wolfTargetId, witchPoisonId, lastGuardedId, currentGuardedId, idiotId}) {
+        if (id >= players.count) return false;
+    }
+    return r.ok && r.p == r.end;
+}
+
+// 廣播後呼叫：內容與上次寫入相同 (例如只是多了一票) 則不寫
+void WerewolfGame::saveSnapshot() {
+    snapshotPending = false;
+    if (!snapshots.enabled()) return;
+    size_t len = encodeSnapshot(snapshots.payload(), SnapshotStore::MAX_PAYLOAD);
+    if (!len || !snapshots.changed(len)) return;
+    unsigned long t0 = hal.clock.micros();
+    if (!snapshots.commit(len)) return;
+    stats.snapshotWriteUs.record(hal.clock.micros() - t0);
+    stats.snapshotWrites++;
+    stats.snapshotBytes = len;
+}
+
+// 開機時接續快照中的一局：本階段重新睜眼 (投票重新開始)，開局倒數重新計時。
+// 只接續進行中或倒數中的一局；大廳與已結束的快照不接續 (手機都已離線，座位不再保留)
+bool WerewolfGame::resume() {
+    size_t len = snapshots.load();
+    if (!len) return false;
+    bool ok = restoreSnapshot(snapshots.payload(), len);
+    if (!ok || !((gameStarted && !gameOver) || isStartingCountdown)) {
+        if (ok) hal.sys.log("Snapshot: no game in progress, starting fresh\n");
+        else hal.sys.log("Snapshot: unreadable (%u bytes), starting fresh\n", (unsigned)len);
+        players = PlayerTable();
+        resetGame();
+        if (!ok) targetPlayerCount = 7; // 可讀的快照沿用設定人數 (主控仍須重新確認)
+        currentPlayerCount = 0;
+        return false;
+    }
+    releaseSeats(players.roleMask[ROLE_SPECTATOR]); // 重開機後沒有任何連線；旁觀者改走旁觀者頻道
+    journal.resume(hal.clock.millis(), snapshots.crc());
+    hal.sys.log("Snapshot: resumed %d seats, round %d, phase %d\n", players.count, roundCount, nightPhase);
+    if (gameStarted && !gameOver && !hunterActionPending) enterPhase(nightPhase);
+    else if (isStartingCountdown) startCountdown();
+    scheduleCheckpoint(); // 之前的輸入不在紀錄內，重播由檢查點開始
+    return true;
+}
+
+// --- 行動紀錄檢查點 ---
+// 快照之外再加上影響之後紀錄的執行期狀態：計時器、投票、語音佇列與連線 (座位)。
+// 於下一次處理輸入前寫入 (該次處理完整留在檢查點之後)；之間沒有紀錄的喚醒不改變狀態，
+// 時間一律相對於開局 (接續) 的時刻，重播接續後即與原本逐筆相同
+
+void WerewolfGame::scheduleCheckpoint() {
+    checkpointPending = true;
+    checkpointAt = hal.clock.millis();
+}
+
+static void writeCue(ByteWriter& w, const AudioCue& c) {
+    w.u32(c.track); w.u32(c.timeoutMs); w.u8(c.followUp); w.u8(c.arg);
+}
+
+static void readCue(ByteReader& r, AudioCue& c) {
+    c.track = r.u32(); c.timeoutMs = r.u32(); c.followUp = r.u8(); c.arg = r.i8();
+}
+
+size_t WerewolfGame::encodeCheckpoint(uint8_t* out, size_t cap) {
+    if (cap < 2) return 0;
+    size_t snap = encodeSnapshot(out + 2, cap - 2);
+    if (!snap) return 0;
+    out[0] = (uint8_t)snap; out[1] = (uint8_t)(snap >> 8);
+
+    unsigned long now = checkpointAt;
+    ByteWriter w(out + 2 + snap, cap - 2 - snap);
+    w.u8(isPhaseLocked | isSeerCheckPending << 1 | openEyesWaiting << 2 | ballot.open << 3 | ballot.kind << 4);
+    w.u32(now - countdownStartTime);
+    uint8_t armed = 0;
+    for (int t = 0; t < TM_COUNT; t++) if (timers.armed(t)) armed |= 1 << t;
+    w.u8(armed);
+    for (int t = 0; t < TM_COUNT; t++) if (armed & (1 << t)) w.u32(timers.dueAt(t) - now); // 已逾期為負值
+    w.u32(ballot.eligible); w.u32(ballot.cast);
+    if (ballot.open) for (int i = 0; i <= PlayerTable::CAPACITY; i++) w.u32(ballot.backers[i]);
+
+    AudioCue cue;
+    unsigned long since;
+    bool playing = audio.playingCue(cue, since);
+    w.u8(playing);
+    if (playing) { w.u32(now - since); writeCue(w, cue); }
+    w.u8(audio.pending());
+    for (int i = 0; i < audio.pending(); i++) writeCue(w, audio.pendingAt(i));
+
+    w.u32(localSeats);
+    w.u8(clients.size());
+    for (auto& cp : clients) { w.u32(cp.first); w.u8(cp.second.seat); w.u8(cp.second.binary); }
+    return w.ok ? w.p - out : 0;
+}
+
+void WerewolfGame::writeCheckpoint() {
+    checkpointPending = false;
+    if (!journal.isEnabled()) return;
+    size_t len = encodeCheckpoint((uint8_t*)frameOut, sizeof(frameOut)); // 同步之外的時間，借用輸出緩衝
+    if (len) journal.checkpoint(checkpointAt, (const uint8_t*)frameOut, len);
+}
+
+bool WerewolfGame::restoreCheckpoint(const uint8_t* data, size_t len) {
+    if (len < 2) return false;
+    size_t snap = data[0] | data[1] << 8;
+    if (len < 2 + snap || !restoreSnapshot(data + 2, snap)) return false;
+
+    unsigned long now = hal.clock.millis();
+    ByteReader r(data + 2 + snap, len - 2 - snap);
+    uint8_t f = r.u8();
+    isPhaseLocked = f & 1; isSeerCheckPending = f & 2; openEyesWaiting = f & 4;
+    countdownStartTime = now - r.u32();
+    timers.clear();
+    uint8_t armed = r.u8();
+    for (int t = 0; t < TM_COUNT; t++) if (armed & (1 << t)) timers.arm(t, now, r.u32());
+    ballot = VoteBox();
+    ballot.open = f & 8; ballot.kind = (VoteKind)(f >> 4 & 1);
+    ballot.eligible = r.u32(); ballot.cast = r.u32();
+    if (ballot.open) {
+        for (int i = 0; i <= PlayerTable::CAPACITY; i++) {
+            ballot.backers[i] = r.u32();
+            ballot.tally[i] = PlayerTable::popcount(ballot.backers[i]);
+        }
+    }
+
+    AudioCue cue, queued[AudioQueue::CAPACITY];
+    unsigned long since = now;
+    bool playing = r.u8();
+    if (playing) { since = now - r.u32(); readCue(r, cue); }
+    int n = r.u8();
+    if (n > AudioQueue::CAPACITY) return false;
+    for (int i = 0; i < n; i++) readCue(r, queued[i]);
+    audio.restore(playing, cue, since, queued, n);
+
+    localSeats = r.u32();
+    clients.clear();
+    int sessions = r.u8();
+    for (int i = 0; i < sessions && r.ok; i++) {
+        uint32_t id = r.u32();
+        int seat = r.u8();
+        bool binary = r.u8();
+        if (seat >= players.count) return false;
+        ClientSession& cs = clients[id];
+        cs.seat = seat; cs.sentIndex = -1; cs.synced = false; cs.deferred = false; cs.binary = binary;
+    }
+    snapshots.begin(roomNumber);
+    checkpointPending = false;
+    lastBroadcast = now - BROADCAST_MS;
+    dirty = true;
+    return r.ok && r.p == r.end;
+}
+
+// --- 主迴圈 ---
+
+unsigned long WerewolfGame::loop() {
+    // --- 1. 到期的階段計時器 (睜眼、預言家結果、假回合、開局倒數) ---
+    stats.wakeups++;
+    unsigned long now = hal.clock.millis();
+    if (checkpointPending) writeCheckpoint();
+    uint8_t fired = 0, events = 0;          // 本次實際發生的轉移 (記入行動紀錄)
+    int timer;
+    unsigned long lateMs;
+    while ((timer = timers.takeDue(hal.clock.millis(), &lateMs)) >= 0) {
+        stats.timerLateMs.record(lateMs);
+        fired |= 1 << timer;
+        onTimer(timer);
+    }
+
+    // --- 2. 語音佇列 (V1.4 BUGFIX: 修正 BUSY PIN 邏輯) ---
+    unsigned long played = audio.played, finished = audio.finished;
+    AudioCue done;
+    if (audio.poll(done)) onCueDone(done);
+    if (audio.finished != finished) events |= LOOP_CUE_DONE;
+    if (audio.played != played) events |= LOOP_CUE_STARTED;
+    if (openEyesWaiting && audio.idle()) { openEyesWaiting = false; onTimer(TM_OPEN_EYES); }
+
+    // --- 3. 人數到齊即開局 (解決鎖定 14 人與不顯示畫面的重點) ---
+    if (!gameStarted && !isStartingCountdown && confirmPressed && currentPlayerCount >= targetPlayerCount) {
+        events |= LOOP_SETUP;
+        setupRoles();
+        startCountdown();
+        scheduleCheckpoint();
+        stateChanged();
+    }
+
+    // --- 4. 搖桿事件 (已去彈跳)：每次只處理一個，其餘立即由下一次 loop() 處理 ---
+    InputEvent input;
+    bool gotInput = hal.input.next(input);
+    if (gotInput) events |= onInput(input);
+
+    // --- 5. 廣播 (距上次廣播滿 BROADCAST_MS 才送) 或補送先前因佇列已滿而略過的 client ---
+    if (dirty && hal.clock.millis() - lastBroadcast >= BROADCAST_MS) {
+        broadcast();
+        if (snapshotPending) saveSnapshot(); // 訊框先送出，再寫非揮發儲存
+    } else if (deferredClients) {
+        flushDeferred();
+    }
+
+    // 只記錄有轉移的喚醒；時間取本次開始時，重播時據此重現
+    if (fired || events) journal.loop(now, fired, events);
+
+    if (metricsPeriodMs && hal.clock.millis() - lastMetricsPublish >= metricsPeriodMs) publishMetrics(); // IDLE_WAKE_MS 保證至少每秒一次
+
+    return gotInput ? 0 : nextWakeMs();
+}
+
+// 主控搖桿：設定人數、確認開局與同意續局；與目前狀態無關的事件直接丟棄
+uint8_t WerewolfGame::onInput(InputEvent ev) {
+    if (!gameStarted && !isStartingCountdown && !confirmPressed) {
+        if (ev == JOY_UP && targetPlayerCount < RolePool::MAX_PLAYERS) {
+            targetPlayerCount++;
+            triggerBuzzer(1);
+            stateChanged();
+            return LOOP_AXIS_UP;
+        }
+        if (ev == JOY_DOWN && targetPlayerCount > RolePool::MIN_PLAYERS) {
+            targetPlayerCount--;
+            triggerBuzzer(1);
+            stateChanged();
+            return LOOP_AXIS_DOWN;
+        }
+        if (ev == JOY_BUTTON) {
+            confirmPressed = true;
+            triggerBuzzer(2);
+            stateChanged();
+            snapshotPending = true; // 記下設定人數 (重開機後沿用)
+            return LOOP_BUTTON;
+        }
+    } else if (gameOver && !adminApprovedReset && ev == JOY_BUTTON) {
+        adminApprovedReset = true;
+        players.votedMask = 0;
+        stateChanged();
+        return LOOP_BUTTON;
+    }
+    return 0;
+}
+
+// 指標快照 (Prometheus 文字格式)
+void WerewolfGame::publishMetrics() {
+    lastMetricsPublish = hal.clock.millis();
+    std::string& out = metricsText;
+    out.clear(); // 保留容量，不重新配置
+    char line[128];
+    snprintf(line, sizeof(line),
+             "heap_free_bytes %u\nheap_min_free_bytes %u\nheap_largest_block_bytes %u\n",
+             stats.heapFree, stats.heapMinFree, stats.heapLargestBlock);
+    out += line;
+    snprintf(line, sizeof(line), "state_changes_total %u\nsyncs_total %u\nframes_sent_total %u\nloop_wakeups_total %u\n",
+             stats.stateChanges, stats.syncs, stats.framesSent, stats.wakeups);
+    out += line;
+    snprintf(line, sizeof(line), "watchers %d\nwatch_frames_total %u\n",
+             hal.transport.watchers(watchChannel()), stats.watchFrames);
+    out += line;
+    snprintf(line, sizeof(line), "ws_sessions %u\nsync_deferred_total %u\nws_sessions_evicted_total %u\n",
+             (unsigned)clients.size(), stats.syncDeferred, stats.sessionsEvicted);
+    out += line;
+    snprintf(line, sizeof(line), "game_players %d\ngame_phase %d\ngame_round %d\n",
+             currentPlayerCount, nightPhase, roundCount);
+    out += line;
+    snprintf(line, sizeof(line), "action_log_records_total %u\naction_log_dropped_total %u\n",
+             journal.records, journal.dropped);
+    out += line;
+    snprintf(line, sizeof(line), "snapshot_enabled %d\nsnapshot_writes_total %u\nsnapshot_bytes %u\n",
+             snapshots.enabled(), stats.snapshotWrites, stats.snapshotBytes);
+    out += line;
+    stats.syncSerializeUs.write(out, "sync_serialize_us");
+    stats.syncBroadcastUs.write(out, "sync_broadcast_us");
+    stats.timerLateMs.write(out, "timer_late_ms");
+    stats.snapshotWriteUs.write(out, "snapshot_write_us");
+    for (auto& cp : clients) {
+        uint32_t queued = 0, dropped = 0;
+        if (!hal.transport.clientStats(cp.first, queued, dropped)) continue;
+        snprintf(line, sizeof(line), "ws_queue_depth{client=\"%u\",seat=\"%d\"} %u\nws_dropped_total{client=\"%u\"} %u\n",
+                 cp.first, players.index[cp.second.seat], queued, cp.first, dropped);
+        out += line;
+    }
+    stats.publish(out);
+}
+
+// 距下次必須呼叫 loop() 的毫秒數：計時器到期、語音需推進或需讀取搖桿時
+unsigned long WerewolfGame::nextWakeMs() {
+    unsigned long now = hal.clock.millis();
+    unsigned long wait = std::min(timers.nextIn(now, IDLE_WAKE_MS), audio.nextPollIn(now, POLL_MS));
+    // 搖桿事件由取樣端喚醒遊戲工作，設定人數與等待主控時不再輪詢
+    if (deferredClients) wait = std::min(wait, RETRY_SEND_MS);
+    if (dirty) wait = std::min(wait, BROADCAST_MS - std::min(BROADCAST_MS, now - lastBroadcast));
+    return wait;
+}
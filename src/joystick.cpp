@@ -0,0 +1,48 @@
+#include "joystick.h"
+
+bool Joystick::emit(InputEvent ev) {
+    if (events.push(ev)) return true;
+    dropped++;
+    return false;
+}
+
+bool Joystick::sample(unsigned long now, int axisX, bool pressed) {
+    bool queued = false;
+
+    // --- X 軸：遲滯判斷所在區域，進入時送出一次，推住不放則連發 ---
+    int zone = axis;
+    if (axis >= 0 && axisX > UP_ENTER) zone = 1;
+    else if (axis <= 0 && axisX < DOWN_ENTER) zone = -1;
+    else if (axis > 0 && axisX < UP_LEAVE) zone = 0;
+    else if (axis < 0 && axisX > DOWN_LEAVE) zone = 0;
+    if (zone != axis) {
+        axis = zone;
+        if (axis) {
+            queued |= emit(axis > 0 ? JOY_UP : JOY_DOWN);
+            axisRepeatAt = now + REPEAT_DELAY_MS;
+        }
+    } else if (axis && (long)(now - axisRepeatAt) >= 0) {
+        queued |= emit(axis > 0 ? JOY_UP : JOY_DOWN);
+        axisRepeatAt += REPEAT_MS;
+        if ((long)(now - axisRepeatAt) >= 0) axisRepeatAt = now + REPEAT_MS; // 取樣曾中斷過久：不補發
+    }
+
+    // --- 按鍵：電位 (含中斷記錄的彈跳) 穩定 DEBOUNCE_MS 後才改變狀態 ---
+    uint32_t e = lastEdge.load(std::memory_order_relaxed);
+    if (e != seenEdge) {
+        seenEdge = e;
+        if ((long)(e - rawSince) > 0) rawSince = e;
+    }
+    if (pressed != raw) { raw = pressed; rawSince = now; }
+    if (raw != button && now - rawSince >= DEBOUNCE_MS) {
+        button = raw;
+        if (button) {
+            queued |= emit(JOY_BUTTON);
+            buttonRepeatAt = now + BUTTON_REPEAT_MS;
+        }
+    } else if (button && raw && (long)(now - buttonRepeatAt) >= 0) {
+        queued |= emit(JOY_BUTTON);
+        buttonRepeatAt = now + BUTTON_REPEAT_MS;
+    }
+    return queued;
+}
@@ -5,20 +5,31 @@
  * 1. 角色新增：獵人(Hunter)、守衛(Guard)、白痴(Idiot)
  * 2. 規則擴充：同守同救死亡、獵人毒死禁射、白痴翻牌機制
  * 3. 優化：動態角色分配 (6-15人)
+ * 4. 架構：規則與階段流程移至 WerewolfGame (game.cpp)，本檔僅負責 ESP32 硬體實作
+ * 5. 工作：遊戲邏輯在專屬工作 (core 1) 執行，WebSocket 回呼只把解析後的指令排入無鎖佇列
+ *    (斷線另有專用佇列，不因指令佇列滿而遺失)
+ * 6. 多桌：一塊板子同時主持 ROOM_COUNT 桌 (RoomSet)，喇叭輪流使用，搖桿與 OLED 交給等待主控的桌
+ * 7. 連線：各系統的連網偵測網址固定回應，DNS 於 AsyncUDP 回呼直接回答 (captive_portal.h)
  * =============================================================
  */
 
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include <DNSServer.h>
+#include <AsyncUDP.h>
 #include <Wire.h>
 #include <U8g2lib.h>
-#include <ArduinoJson.h>
 #include <DFRobotDFPlayerMini.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <algorithm>
 #include <map>
-#include <vector>
-#include <set>
+#include "hal.h"
+#include "captive_portal.h"
+#include "joystick.h"
+#include "room.h"
+#include "spsc_queue.h"
+#include "web_index.h"   // 建置時由 web/index.html 產生
 
 // --- 硬體引腳 ---
 #define OLED_SDA      21
@@ -28,448 +39,291 @@
 #define BELL_PIN      14
 #define DF_BUSY_PIN   18 
 
+// --- 同時主持的桌數 (每桌約 45 KB：行動紀錄、序列化緩衝與指標快照) ---
+#ifndef ROOM_COUNT
+#define ROOM_COUNT MAX_ROOMS
+#endif
+
+// --- OLED 緩衝模式 (1 = 頁緩衝，省下 1 KB 全畫面緩衝) ---
+#ifndef OLED_PAGE_BUFFER
+#define OLED_PAGE_BUFFER 1
+#endif
+
 // --- 物件實例 ---
 HardwareSerial dfSerial(2); 
 DFRobotDFPlayerMini myDFPlayer;
-U8G2_SH1106_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, -1);
-DNSServer dnsServer;
+#if OLED_PAGE_BUFFER
+U8G2_SH1106_128X64_NONAME_1_HW_I2C u8g2(U8G2_R0, -1);   // 頁緩衝：128 bytes，繪製時逐頁重畫
+#else
+U8G2_SH1106_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, -1);   // 全緩衝：1 KB
+#endif
+AsyncUDP dnsUdp;                                // 強制門戶 DNS (見 onDnsPacket())
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
+AsyncEventSource* watchFeeds[ROOM_COUNT] = {};  // 旁觀者頻道 /watch/N (Server-Sent Events)
 
 // --- 網路設定 ---
 IPAddress apIP(192, 168, 4, 1);
 const byte DNS_PORT = 53;
+#define WS_PING_SEC      5     // 閒置多久送出 ping (keepAlive)
+#define WS_DEAD_SEC      15    // 多久沒收到任何資料 (含 pong) 即關閉連線
+#define WS_DEFER_QUEUED  4     // 待送訊框達此數量時延後同步，之後合併為一個差量
+#define WS_CLEANUP_MS    1000  // 遊戲工作至少每隔這麼久清理一次已斷線的 client
+
+// --- ESP32 硬體實作 ---
+
+class Esp32Audio : public AudioOut {
+public:
+    void play(int fileID) override { myDFPlayer.play(fileID); }
+    bool isBusy() override { return digitalRead(DF_BUSY_PIN) == LOW; }
+    void tone(int freq, int durationMs) override { ::tone(BELL_PIN, freq, durationMs); }
+    bool wakesOnIdle() override { return true; }   // 見 onBusyIdle()
+};
+
+class Esp32Display : public Display {
+public:
+    void firstPage() override { u8g2.firstPage(); }
+    bool nextPage() override { return u8g2.nextPage(); }
+    void drawStr(int x, int y, const char* s) override { u8g2.drawStr(x, y, s); }
+    void setCursor(int x, int y) override { u8g2.setCursor(x, y); }
+    void print(const char* s) override { u8g2.print(s); }
+    void print(int v) override { u8g2.print(v); }
+};
+
+class Esp32Transport : public Transport {
+public:
+    // 佇列已滿時函式庫會直接丟棄訊框：先檢查並記錄，client 之後會因版本不連續要求 resync
+    void text(uint32_t clientId, const char* data, size_t len) override {
+        AsyncWebSocketClient* c = writable(clientId);
+        if (c) c->text(data, len);
+    }
+    void binary(uint32_t clientId, const uint8_t* data, size_t len) override {
+        AsyncWebSocketClient* c = writable(clientId);
+        if (c) c->binary(data, len);
+    }
 
-// --- 遊戲變數 ---
-std::map<String, String> playerRoleMap;      
-std::map<String, int> playerIndexMap;        
-std::map<uint32_t, String> clientIdToDeviceId; 
-std::vector<String> deadPlayers;             
-std::vector<String> lastNightDeadPlayers;    // V1.5: 紀錄昨晚死亡玩家
-std::set<String> restartVotes;               
-
-int targetPlayerCount = 7;                   
-int currentPlayerCount = 0;                  
-bool gameStarted = false;                    
-bool isStartingCountdown = false;            
-unsigned long countdownStartTime = 0;
-bool confirmPressed = false;                 
-bool gameOver = false;                       
-bool adminApprovedReset = false;             
-String winner = "NONE";                      
-
-int nightPhase = -1;      // -1:等待, 4:守衛, 0:狼人, 1:預言家, 2:女巫, 3:白天
-int roundCount = 1;       
-String wolfTargetId = ""; 
-String witchPoisonId = "";
-bool witchHasHeal = true; 
-bool witchHasPoison = true;
-
-// --- 新角色變數 ---
-String lastGuardedId = "";    // 守衛上一晚守的人
-String currentGuardedId = ""; // 守衛今晚守的人
-bool hunterCanShoot = true;   // 獵人是否有子彈
-bool idiotRevealed = false;   // 白痴是否已翻牌免死
-String idiotId = "";          // 記錄誰是白痴
-
-unsigned long phaseStartTime = 0;            
-bool isPhaseLocked = false; 
-unsigned long seerCheckDelayStart = 0;  
-bool isSeerCheckPending = false;        
-unsigned long audioPlayStartTime = 0;    
-bool isAudioPlaying = false;             
-
-// --- V1.4 新增變數 ---
-bool hunterActionPending = false; // 是否正在等待獵人行動
-unsigned long phaseDelayStartTime = 0; // 用於已死亡神職的假性延遲
-
-
-void playVoice(int fileID, bool wait) {
-    Serial.printf("Audio: Playing #%d\n", fileID);
-    myDFPlayer.play(fileID);
-    delay(50); // Add a small delay for command stability
-    audioPlayStartTime = millis();  
-    isAudioPlaying = wait;          
-}
-
-void triggerBuzzer(int type) {
-    if (type == 1) tone(BELL_PIN, 1000, 100); 
-    if (type == 2) tone(BELL_PIN, 800, 500);  
-}
+    // 以 AsyncWebSocketMessageBuffer 共用：引用計數歸零後由 _cleanBuffers() 回收
+    bool makeShared(SharedFrame& f, size_t len) override {
+        AsyncWebSocketMessageBuffer* buf = ws.makeBuffer(len);
+        if (!buf) return false;
+        buf->lock();
+        f.data = (char*)buf->get(); f.len = len; f.impl = buf;
+        return true;
+    }
+    void sendShared(uint32_t clientId, SharedFrame& f) override {
+        AsyncWebSocketClient* c = writable(clientId);
+        if (!c) return;
+        if (f.binary) c->binary((AsyncWebSocketMessageBuffer*)f.impl);
+        else c->text((AsyncWebSocketMessageBuffer*)f.impl);
+    }
+    void releaseShared(SharedFrame& f) override {
+        ((AsyncWebSocketMessageBuffer*)f.impl)->unlock();
+        ws._cleanBuffers();
+        f = SharedFrame();
+    }
 
-bool isAlive(String id) {
-    for (String d : deadPlayers) { if (d == id) return false; }
-    return true;
-}
+    // 背壓：佇列還有餘裕才送；否則引擎保留差異，佇列消化後只補送一次合併的差量
+    bool canSend(uint32_t clientId) override {
+        AsyncWebSocketClient* c = ws.client(clientId);
+        return c && c->status() == WS_CONNECTED && c->queueLen() < WS_DEFER_QUEUED;
+    }
+    void close(uint32_t clientId) override { ws.close(clientId); }
+    void forget(uint32_t clientId) { drops.erase(clientId); }
 
-bool isRoleAlive(String roleName) {
-    for (auto const& p : playerRoleMap) {
-        if (p.second == roleName && isAlive(p.first)) return true;
+    // 旁觀者：AsyncEventSource 一次送給所有訂閱者，不建立個別 session
+    int watchers(int channel) override { return watchFeeds[channel] ? watchFeeds[channel]->count() : 0; }
+    void broadcast(int channel, const char* data, size_t len) override {
+        if (watchFeeds[channel]) watchFeeds[channel]->send(data);
     }
-    return false;
-}
 
-void checkVictory() {
-    if (!gameStarted || isStartingCountdown || gameOver) return;
-    int wolves = 0, humans = 0;
-    for (auto const& p : playerRoleMap) {
-        if (!isAlive(p.first)) continue; 
-        if (p.second == "狼人") wolves++;
-        else if (p.second != "Joined" && p.second != "旁觀者") humans++;
+    bool clientStats(uint32_t clientId, uint32_t& queued, uint32_t& dropped) override {
+        AsyncWebSocketClient* c = ws.client(clientId);
+        if (!c) return false;
+        queued = c->queueLen();
+        auto it = drops.find(clientId);
+        dropped = (it != drops.end()) ? it->second : 0;
+        return true;
     }
 
-    bool justOver = false;
-    if (wolves == 0) {
-        if (!gameOver) { // 確保只觸發一次
-            gameOver = true; winner = "HUMANS"; justOver = true;
-        }
+private:
+    std::map<uint32_t, uint32_t> drops;     // 只在遊戲工作內存取
+
+    AsyncWebSocketClient* writable(uint32_t clientId) {
+        AsyncWebSocketClient* c = ws.client(clientId);
+        if (c && c->queueIsFull()) { drops[clientId]++; return nullptr; }
+        return c;
     }
-    else if (wolves >= humans) {
-        if (!gameOver) { // 確保只觸發一次
-            gameOver = true; winner = "WOLVES"; justOver = true;
-        }
+};
+
+// 搖桿：按鍵中斷 + esp_timer 週期取樣，去彈跳後的事件經佇列交給遊戲工作 (見 sampleJoystick())
+Joystick joystick;
+
+class Esp32Input : public Input {
+public:
+    bool next(InputEvent& ev) override { return joystick.next(ev); }
+};
+
+class Esp32Clock : public Clock {
+public:
+    unsigned long millis() override { return ::millis(); }
+    unsigned long micros() override { return ::micros(); }
+    void delay(unsigned long ms) override { ::delay(ms); }
+};
+
+class Esp32System : public System {
+public:
+    long random(long lo, long hi) override { return ::random(lo, hi); }
+    uint32_t freeHeap() override { return ESP.getFreeHeap(); }
+    uint32_t minFreeHeap() override { return ESP.getMinFreeHeap(); }
+    uint32_t largestFreeBlock() override { return ESP.getMaxAllocHeap(); }
+    void vlog(const char* fmt, va_list ap) override {
+        char buf[128];
+        vsnprintf(buf, sizeof(buf), fmt, ap);
+        Serial.print(buf);
     }
-
-    if (justOver) {
-        // V1.5: 播放勝利音效 (請替換為您的音檔ID)
-        if (winner == "HUMANS") playVoice(20, false); // 20: 好人勝利音效
-        else if (winner == "WOLVES") playVoice(21, false); // 21: 狼人勝利音效
+    // 快照存於 NVS (僅遊戲工作呼叫)；NVS 本身以頁輪替分散寫入
+    size_t loadBlob(const char* key, void* buf, size_t cap) override {
+        if (!prefs.begin("werewolf", true)) return 0;
+        size_t n = prefs.getBytesLength(key);
+        n = (n && n <= cap) ? prefs.getBytes(key, buf, cap) : 0;
+        prefs.end();
+        return n;
     }
-}
-
-void setupRoles() {
-    int seq = 1;
-    idiotId = ""; idiotRevealed = false; hunterCanShoot = true;
-    for (auto &p : playerRoleMap) if (p.second != "旁觀者") playerIndexMap[p.first] = seq++;
-    
-    // 動態配制角色池
-    std::vector<String> rPool = {"狼人", "狼人", "預言家", "女巫"};
-    if(targetPlayerCount >= 7) rPool.push_back("獵人");
-    if(targetPlayerCount >= 9) rPool.push_back("狼人");
-    if(targetPlayerCount >= 10) rPool.push_back("守衛");
-    if(targetPlayerCount >= 12) rPool.push_back("狼人");
-    if(targetPlayerCount >= 13) rPool.push_back("白痴");
-    
-    while(rPool.size() < (size_t)targetPlayerCount) rPool.push_back("平民");
-    
-    // 洗牌
-    for(int i = rPool.size() - 1; i > 0; i--) { 
-        int j = random(0, i + 1); String t = rPool[i]; rPool[i] = rPool[j]; rPool[j] = t; 
+    bool saveBlob(const char* key, const void* data, size_t len) override {
+        if (!prefs.begin("werewolf", false)) return false;
+        bool ok = prefs.putBytes(key, data, len) == len;
+        prefs.end();
+        return ok;
     }
-    
-    int rIdx = 0;
-    for (auto &p : playerRoleMap) {
-        if (p.second != "旁觀者") {
-            p.second = rPool[rIdx++];
-            if(p.second == "白痴") idiotId = p.first;
+private:
+    Preferences prefs;
+};
+
+Esp32Audio audioOut;
+Esp32Display display;
+Esp32Transport transport;
+Esp32Input input;
+Esp32Clock clockSrc;
+Esp32System sys;
+Hal hal = { audioOut, display, transport, input, clockSrc, sys };
+RoomSet rooms(hal, ROOM_COUNT);
+
+// --- 遊戲工作 ---
+// 所有遊戲狀態只在此工作內讀寫；WebSocket 回呼 (AsyncTCP 工作) 只解析並排入指令。
+// 送出 (ws.client()/text()/close()) 與 cleanupClients() 都在此工作，client 不會在使用中被釋放
+#define GAME_TASK_CORE   1
+#define GAME_TASK_PRIO   2
+#define GAME_TASK_STACK  8192
+#define DEPART_SLOTS     64    // 大於 lwIP 可同時維持的 TCP 連線數：未清理的 client 不會超過此數
+#if defined(CONFIG_LWIP_MAX_ACTIVE_TCP)
+static_assert(DEPART_SLOTS >= CONFIG_LWIP_MAX_ACTIVE_TCP, "departed queue must hold every open connection");
+#endif
+SpscQueue<Command, 32> inbox;               // 生產者: AsyncTCP 工作；消費者: 遊戲工作
+SpscQueue<uint32_t, DEPART_SLOTS> departed; // 已斷線的 client (同上)；與指令分開，不受指令佇列影響
+volatile uint32_t inboxDropped = 0;         // 佇列滿而丟棄的指令數
+volatile uint32_t departDropped = 0;        // 斷線佇列滿而遺失的斷線數 (應恆為 0)
+TaskHandle_t gameTaskHandle = nullptr;
+
+// 事件驅動：有指令、BUSY 轉閒或到了引擎要求的時間才醒來，不再每 10ms 空轉
+void gameTask(void *) {
+    rooms.begin(); // 確保開機第一時間顯示 SET PLAYER 畫面
+    Command cmd;
+    uint32_t gone[DEPART_SLOTS];
+    for (;;) {
+        // 先取出斷線名單再清空指令：同一連線斷線前排入的指令必定先處理，不會在斷線後重建 session
+        int n = 0;
+        while (n < DEPART_SLOTS && departed.pop(gone[n])) n++;
+        while (inbox.pop(cmd)) rooms.handleCommand(cmd);
+        for (int i = 0; i < n; i++) {
+            transport.forget(gone[i]);
+            Command bye;
+            bye.clientId = gone[i];
+            bye.action = ACT_DISCONNECT;
+            rooms.handleCommand(bye);
         }
+        unsigned long waitMs = rooms.loop();
+        ws.cleanupClients(); // 斷線已交給引擎，之後才釋放 client
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(std::min(waitMs, (unsigned long)WS_CLEANUP_MS)));
     }
 }
 
-void resetGame() {
-    Serial.println("DEBUG: resetGame() called.");
-    gameStarted = false; gameOver = false; isStartingCountdown = false; 
-    adminApprovedReset = false; winner = "NONE";
-    nightPhase = -1; 
-    roundCount = 1;
-    deadPlayers.clear(); lastNightDeadPlayers.clear(); restartVotes.clear(); confirmPressed = false;
-    for (auto &p : playerRoleMap) { if (p.second != "旁觀者") p.second = "Joined"; }
-    wolfTargetId = ""; witchPoisonId = ""; witchHasHeal = true; witchHasPoison = true;
-    lastGuardedId = ""; currentGuardedId = ""; hunterCanShoot = true; idiotRevealed = false;
-    isPhaseLocked = false; isSeerCheckPending = false;
+// DFPlayer 播放結束 (BUSY 由 LOW 轉 HIGH)：喚醒遊戲工作推進語音佇列
+void IRAM_ATTR onBusyIdle() {
+    BaseType_t woken = pdFALSE;
+    if (gameTaskHandle) vTaskNotifyGiveFromISR(gameTaskHandle, &woken);
+    if (woken) portYIELD_FROM_ISR();
 }
 
-// --- WebSocket 處理 ---
-
-void syncGameState() {
-    // V1.8 Memory-Debug: 在每次同步狀態時印出剩餘記憶體，用於觀察記憶體洩漏或碎片化問題
-    Serial.printf("Sync State - Free Heap: %u bytes\n", ESP.getFreeHeap());
-
-    checkVictory();
-    
-    // 自動跳過無人職位 (V1.4 - 增加延遲)
-    if (gameStarted && !gameOver && !isPhaseLocked && phaseDelayStartTime == 0 && !hunterActionPending) {
-        if ((nightPhase == 4 && !isRoleAlive("守衛")) ||
-            (nightPhase == 1 && !isRoleAlive("預言家")) ||
-            (nightPhase == 2 && !isRoleAlive("女巫"))) {
-            phaseDelayStartTime = millis();
-            isPhaseLocked = true; // 鎖定介面，顯示「天黑請閉眼」
-        }
-    }
-
-    DynamicJsonDocument targetDoc(2048);
-    JsonArray targets = targetDoc.to<JsonArray>();
-    for (auto const& p : playerIndexMap) {
-        if (isAlive(p.first)) {
-            JsonObject obj = targets.createNestedObject();
-            obj["id"] = p.first; obj["index"] = p.second;
-        }
-    }
+// 搖桿按鍵電位變化：只記錄時間，去彈跳由取樣端判斷
+void IRAM_ATTR onJoystickEdge() {
+    joystick.edge(millis());
+}
 
-    int cdSec = (isStartingCountdown) ? max(0, (int)(3 - (millis() - countdownStartTime) / 1000)) : 0;
-
-    for (auto const& cp : clientIdToDeviceId) {
-        DynamicJsonDocument m(3000);
-        String devId = cp.second;
-        m["type"] = "update";
-        m["role"] = playerRoleMap[devId];
-        m["index"] = playerIndexMap[devId];
-        m["isDead"] = !isAlive(devId);
-        m["phase"] = nightPhase;
-        m["gameOver"] = gameOver;
-        m["winner"] = winner;
-        m["adminApproved"] = adminApprovedReset;
-        m["targets"] = targets;
-        m["isPhaseLocked"] = isPhaseLocked || hunterActionPending; 
-        m["hunterActionPending"] = hunterActionPending;
-        m["countdown"] = cdSec;
-        m["isStarting"] = isStartingCountdown;
-        m["idiotRevealed"] = (devId == idiotId && idiotRevealed);
-
-        // V1.6: 新增等待玩家狀態標記與計數
-        m["waitingForPlayers"] = (!gameStarted && confirmPressed && !isStartingCountdown);
-        m["currentCount"] = currentPlayerCount;
-        m["targetCount"] = targetPlayerCount;
-
-        // V1.4 BUGFIX: 傳送續局投票者列表
-        JsonArray votedPlayers = m.createNestedArray("votedPlayers");
-        if (gameOver && adminApprovedReset) {
-            for (const String& voterId : restartVotes) {
-                votedPlayers.add(voterId);
-            }
-        }
+// esp_timer 工作每 Joystick::SAMPLE_MS 取樣一次；有事件才喚醒遊戲工作 (遊戲工作不再輪詢搖桿)
+void sampleJoystick(void *) {
+    bool pressed = digitalRead(JOYSTICK_SW) == LOW;
+    if (joystick.sample(millis(), analogRead(JOYSTICK_X), pressed) && gameTaskHandle) xTaskNotifyGive(gameTaskHandle);
+}
 
-        // 獵人開槍判斷
-        m["canShoot"] = (playerRoleMap[devId] == "獵人" && !isAlive(devId) && hunterCanShoot);
-        
-        if (nightPhase == 3) {
-            // V1.5: 產生昨晚死亡報告
-            // V1.8 Memory-Fix: 優化字串拼接以減少記憶體碎片。預先申請64位元組空間。
-            String deathNoteStr;
-            deathNoteStr.reserve(64); 
-
-            if (lastNightDeadPlayers.empty()) {
-                deathNoteStr = "昨晚是平安夜。";
-            } else {
-                deathNoteStr = "昨晚死亡的玩家是：";
-                for (size_t i = 0; i < lastNightDeadPlayers.size(); ++i) {
-                    deathNoteStr += playerIndexMap[lastNightDeadPlayers[i]];
-                    deathNoteStr += "號";
-                    if (i < lastNightDeadPlayers.size() - 1) deathNoteStr += "、";
-                }
-                deathNoteStr += "。";
-            }
-            m["deathNote"] = deathNoteStr;
-        }
-        
-        if (nightPhase == 4 && playerRoleMap[devId] == "守衛") m["lastGuardedId"] = lastGuardedId;
-        if (nightPhase == 2 && playerRoleMap[devId] == "女巫") {
-            m["hasHeal"] = witchHasHeal; m["hasPoison"] = witchHasPoison;
-            m["wolfTargetIndex"] = (wolfTargetId != "") ? playerIndexMap[wolfTargetId] : 0;
-            m["wolfTargetId"] = wolfTargetId;
-        }
-        
-        String out; serializeJson(m, out);
-        ws.text(cp.first, out);
-    }
+// --- WebSocket 處理 ---
 
-    // OLED 顯示
-    u8g2.clearBuffer();
-    if (isStartingCountdown) {
-        u8g2.drawStr(0, 20, "READYING...");
-        u8g2.setCursor(60, 50); u8g2.print(cdSec);
-    } else if (gameOver) {
-        u8g2.drawStr(0, 15, "GAME OVER!");
-        u8g2.setCursor(0, 35); u8g2.print("Win: "); u8g2.print(winner);
-        if (adminApprovedReset) {
-            u8g2.drawStr(0, 55, "Ready: ");
-            u8g2.setCursor(70, 55); u8g2.print(restartVotes.size());
-            u8g2.print("/"); u8g2.print(targetPlayerCount);
-        } else {
-            u8g2.drawStr(0, 55, "> PRESS SW <");
-        }
-    } else if (!gameStarted) {
-        // V1.6: 區分設定人數與等待連線狀態 (OLED)
-        if (confirmPressed) {
-            u8g2.drawStr(0, 20, "WAITING JOIN...");
-            u8g2.setCursor(30, 50); u8g2.print(currentPlayerCount); 
-            u8g2.print(" / "); u8g2.print(targetPlayerCount);
-        } else {
-            u8g2.drawStr(0, 20, "SET PLAYER:"); u8g2.setCursor(70, 20); u8g2.print(targetPlayerCount);
-            u8g2.setCursor(0, 50); u8g2.print("Joined: "); u8g2.print(currentPlayerCount);
-        }
-    } else {
-        u8g2.setCursor(0, 15); u8g2.print("Day: "); u8g2.print(roundCount);
-        String pName = "UNKNOWN";
-        if(nightPhase==4) pName = "GUARD ACTING";
-        else if(nightPhase==0) pName = "WOLF ACTING";
-        else if(nightPhase==1) pName = "SEER ACTING";
-        else if(nightPhase==2) pName = "WITCH ACTING";
-        else pName = "VOTING TIME";
-        u8g2.drawStr(0, 40, pName.c_str());
-    }
-    u8g2.sendBuffer();
+// 只由 AsyncTCP 工作呼叫 (單一生產者)
+void enqueue(const Command& cmd) {
+    if (!inbox.push(cmd)) { inboxDropped++; return; }
+    if (gameTaskHandle) xTaskNotifyGive(gameTaskHandle);
 }
 
 void onWsEvent(AsyncWebSocket *s, AsyncWebSocketClient *c, AwsEventType t, void *arg, uint8_t *d, size_t l){
-    if(t!=WS_EVT_DATA) return;
-    DynamicJsonDocument doc(1024);
-    deserializeJson(doc,(char*)d,l);
-    String action=doc["action"];
-    String devId=doc["deviceId"];
-
-    if(action=="connect"){
-        clientIdToDeviceId[c->id()]=devId;
-        if(!playerRoleMap.count(devId)){
-            playerRoleMap[devId]=gameStarted?"旁觀者":"Joined";
-            currentPlayerCount++;
-        }
-        syncGameState();
-    }
-    else if(action=="restart"){
-        if (adminApprovedReset) { // 僅在GM同意後才接受續局投票
-            restartVotes.insert(devId);
-            if(restartVotes.size() >= (size_t)targetPlayerCount){
-                // 人數到齊，自動開局
-                resetGame(); 
-                setupRoles(); 
-                isStartingCountdown = true; 
-                countdownStartTime = millis(); 
-                triggerBuzzer(2);
-            }
-        }
-        syncGameState();
-    }
-    else if (action == "guardProtect") {
-        currentGuardedId = doc["targetId"].as<String>();
-        lastGuardedId = currentGuardedId; // 更新禁守紀錄
-        playVoice(13, true); // 守衛閉眼
-        nightPhase = 0; phaseStartTime = millis(); isPhaseLocked = true; syncGameState();
+    if (t == WS_EVT_CONNECT) {
+        // 手機休眠或離開 AP 時 TCP 不會關閉：閒置送 ping，收不到任何回應即斷線
+        c->keepAlivePeriod(WS_PING_SEC);
+        c->client()->setRxTimeout(WS_DEAD_SEC);
+        return;
     }
-    else if (action == "wolfKill") {
-        wolfTargetId = doc["targetId"].as<String>();
-        playVoice(3, true); 
-        nightPhase = 1; phaseStartTime = millis(); isPhaseLocked = true; syncGameState();
+    if (t == WS_EVT_DISCONNECT) {
+        // 不可阻塞網路工作：佇列容量已涵蓋所有連線，滿了只可能是遊戲工作停擺，計數後丟棄
+        if (!departed.push(c->id())) departDropped++;
+        if (gameTaskHandle) xTaskNotifyGive(gameTaskHandle);
+        return;
     }
-    else if (action == "seerCheck") {
-        if (isSeerCheckPending) return; // V1.4 BUGFIX: 防止重複查驗
-        String tRole = playerRoleMap[doc["targetId"].as<String>()];
-        c->text("{\"type\":\"seerResult\", \"role\":\"" + tRole + "\"}");
-        isSeerCheckPending = true; 
-        seerCheckDelayStart = millis();
-        isPhaseLocked = true; // V1.4 BUGFIX: 立即鎖定介面
-        syncGameState();
-    }
-    else if (action == "witchHeal" || action == "witchPoison" || action == "witchSkip") {
-        bool healed = false;
-        if(action == "witchHeal") { 
-            witchHasHeal = false; healed = true; 
-        } else if(action == "witchPoison") { 
-            witchHasPoison = false; 
-            witchPoisonId = doc["targetId"].as<String>(); 
-            if(playerRoleMap[witchPoisonId] == "獵人") hunterCanShoot = false; // 毒殺不能開槍
-        }
-        
-        // V1.4 - 結算死亡並檢查獵人
-        std::vector<String> newly_dead;
-        if (healed) {
-            if (wolfTargetId == currentGuardedId) newly_dead.push_back(wolfTargetId); // 同守同救 -> 死
-        } else {
-            if (wolfTargetId != "" && wolfTargetId != currentGuardedId) newly_dead.push_back(wolfTargetId);
-        }
-        if (witchPoisonId != "") newly_dead.push_back(witchPoisonId);
+    if(t!=WS_EVT_DATA) return;
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    Command cmd;
+    if (!parseCommand(c->id(), (const char*)d, l, info->opcode == WS_BINARY, cmd)) return;
+    enqueue(cmd);
+}
 
-        lastNightDeadPlayers = newly_dead; // V1.5: 記錄昨晚死者
+// --- 強制門戶 ---
+volatile uint32_t dnsQueries = 0, captiveProbes = 0;
+
+// DNS 由 AsyncUDP 回呼 (LwIP 工作) 收到即回答，不再由 Arduino loop() 每 10ms 輪詢
+void onDnsPacket(AsyncUDPPacket& packet) {
+    static uint8_t reply[512];                  // 只在 AsyncUDP 工作內使用
+    const uint8_t ip[4] = {apIP[0], apIP[1], apIP[2], apIP[3]};
+    size_t n = dnsReply(packet.data(), packet.length(), ip, reply, sizeof(reply));
+    if (!n) return;
+    packet.write(reply, n);
+    dnsQueries++;
+}
 
-        bool hunterDiedThisNight = false;
-        for(String id : newly_dead) {
-            deadPlayers.push_back(id);
-            if(playerRoleMap[id] == "獵人" && hunterCanShoot) {
-                hunterDiedThisNight = true;
-            }
-        }
+// 引導頁直接由 flash 送出；偵測請求不可被快取，否則下次連線不會再跳出登入視窗
+void sendLanding(AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *res = request->beginResponse_P(200, "text/html", (const uint8_t*)CAPTIVE_LANDING_HTML,
+                                                           CAPTIVE_LANDING_LEN);
+    res->addHeader("Cache-Control", "no-store");
+    request->send(res);
+}
 
-        playVoice(8, true); // 女巫閉眼
-        
-        if(hunterDiedThisNight) {
-            hunterActionPending = true; // 鎖定UI，等待獵人行動
-            playVoice(14, false); // V1.4 MOD: 播放獵人行動提示音 (ID 14 為示意)
-        } else {
-            nightPhase = 3; // 正常進入白天
-            phaseStartTime = millis(); 
-            isPhaseLocked = true;
-        }
-        syncGameState();
-    }
-    else if (action == "champExile") {
-        String exId = doc["targetId"].as<String>();
-        bool hunterExiled = false;
-
-        if (exId != "") {
-            if (exId == idiotId && !idiotRevealed) {
-                idiotRevealed = true; // 白痴翻牌免死
-            } else {
-                deadPlayers.push_back(exId);
-                if (playerRoleMap[exId] == "獵人" && hunterCanShoot) {
-                    hunterExiled = true;
-                }
-            }
-        }
-        
-        if (hunterExiled) {
-            hunterActionPending = true; // 鎖定UI，等待獵人
-            playVoice(14, false); // V1.4 MOD: 播放獵人行動提示音 (ID 14 為示意)
-        } else {
-            wolfTargetId = ""; witchPoisonId = ""; currentGuardedId = ""; lastNightDeadPlayers.clear(); // V1.5: 進入新夜晚，清空死者名單
-            playVoice(1, true); // V1.4 BUGFIX: 進入新夜晚時播放天黑音效
-            // V1.4 MOD: 根據守衛是否存在決定下一晚的起始
-            if (isRoleAlive("守衛")) {
-                nightPhase = 4;
-            } else {
-                nightPhase = 0;
-            }
-            roundCount++; // 進入下一晚
-            phaseStartTime = millis(); isPhaseLocked = true;
-        }
-        syncGameState();
-    }
-    else if (action == "hunterShoot") {
-        String shotId = doc["targetId"].as<String>();
-        if (shotId != "") {
-            deadPlayers.push_back(shotId);
-        }
-        hunterCanShoot = false;
-        playVoice(15, false); // V1.4 MOD: 獵人開槍音效 (ID 15 為示意, 請更換為實際音檔)
-        triggerBuzzer(2);
-
-        if(hunterActionPending) {
-            hunterActionPending = false;
-            // 判斷獵人死亡的時間點以決定下一階段
-            if(nightPhase == 3) { // 獵人在白天被投票出局，準備進入新夜晚
-                // V1.7 BUGFIX: 增加阻塞延遲以確保槍聲音效能完整播放
-                // 在播放下一個"天黑"音效前，等待槍聲音效播放完畢或超時
-                unsigned long waitStart = millis();
-                while(digitalRead(DF_BUSY_PIN) == LOW && (millis() - waitStart < 3500)) { // 等待最多2秒
-                    delay(10);
-                }
-
-                wolfTargetId = ""; witchPoisonId = ""; currentGuardedId = ""; lastNightDeadPlayers.clear(); // V1.5: 進入新夜晚，清空死者名單
-                playVoice(1, true); // V1.4 BUGFIX: 進入新夜晚時播放天黑音效
-                // V1.4 MOD: 根據守衛是否存在決定下一晚的起始
-                if (isRoleAlive("守衛")) {
-                    nightPhase = 4;
-                } else {
-                    nightPhase = 0;
-                }
-                roundCount++; // 進入新的一晚
-                phaseStartTime = millis(); isPhaseLocked = true;
-            } else { // 獵人在晚上死亡 (可能是 守/狼/預/巫 階段)
-                nightPhase = 3; // 進入白天階段
-                phaseStartTime = millis(); isPhaseLocked = true;
-            }
-        }
-        syncGameState();
-    }
+void sendCaptive(AsyncWebServerRequest *request, const CaptiveProbe& probe) {
+    captiveProbes++;
+    if (probe.reply == CAPTIVE_LANDING) sendLanding(request);
+    else request->redirect(CAPTIVE_LANDING_URL);
+}
+
+// /metrics、/actionlog 的 ?room=N (1 起算)；指標與紀錄皆可由任何工作讀取
+WerewolfGame& requestedRoom(AsyncWebServerRequest *request) {
+    int room = request->hasParam("room") ? request->getParam("room")->value().toInt() : 1;
+    return rooms.game((room >= 1 && room <= rooms.count()) ? room - 1 : 0);
 }
 
 // --- 程式入口 ---
@@ -499,294 +353,90 @@ void setup() {
     WiFi.mode(WIFI_AP);
     WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
     WiFi.softAP("Werewolf_V130", "12345678", 1, 0, 15); // 支援到 15 人
-    dnsServer.start(DNS_PORT, "*", apIP);
+    if (dnsUdp.listen(DNS_PORT)) dnsUdp.onPacket(onDnsPacket);
     ws.onEvent(onWsEvent); server.addHandler(&ws);
+    // 旁觀者頻道：每桌一個 SSE 端點，新訂閱者由遊戲工作重送目前畫面；
+    // 純 HTTP 串流，可由 tools/watch_relay.py 轉播，旁觀者不必佔用 softAP 名額
+    for (int i = 0; i < rooms.count(); i++) {
+        watchFeeds[i] = new AsyncEventSource(String("/watch/") + (i + 1));
+        watchFeeds[i]->onConnect([i](AsyncEventSourceClient *client) {
+            Command cmd;
+            cmd.action = ACT_WATCH;
+            cmd.room = i + 1;
+            enqueue(cmd);
+        });
+        server.addHandler(watchFeeds[i]);
+    }
 
-    server.on("/generate_204", [](AsyncWebServerRequest *r){ r->redirect("http://192.168.4.1"); });
+    // 執行指標：遊戲工作每秒更新的快照，加上網路端的指令佇列狀態 (?room=N 指定桌號，預設第 1 桌)
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        std::string body = requestedRoom(request).metrics().read();
+        char line[96];
+        snprintf(line, sizeof(line), "inbox_depth %u\ninbox_dropped_total %u\n", (unsigned)inbox.size(), (unsigned)inboxDropped);
+        body += line;
+        snprintf(line, sizeof(line), "departed_dropped_total %u\n", (unsigned)departDropped);
+        body += line;
+        snprintf(line, sizeof(line), "dns_queries_total %u\ncaptive_probes_total %u\n", (unsigned)dnsQueries,
+                 (unsigned)captiveProbes);
+        body += line;
+        request->send(200, "text/plain; version=0.0.4", body.c_str());
+    });
+    // 行動紀錄：二進位下載，於開發機以 program replay 重播 (見 src/native/replay.cpp)
+    // 分段 (chunked) 送出；下載途中紀錄繞回覆蓋匯出範圍時提早結束，
+    // 重播工具依 header 的紀錄區長度回報不完整 (固定 Content-Length 會卡住直到逾時)
+    server.on("/actionlog", HTTP_GET, [](AsyncWebServerRequest *request) {
+        ActionLog& log = requestedRoom(request).actionLog();
+        ActionLog::Export e;
+        size_t total = log.beginExport(e);
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+            [&log, e, total](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+                size_t n = index < total ? log.exportRead(e, index, buf, maxLen) : 0;
+                if (!n && index < total) Serial.printf("actionlog: export overwritten at %u of %u bytes\n",
+                                                       (unsigned)index, (unsigned)total);
+                return n;
+            });
+        response->addHeader("X-Actionlog-Length", String((unsigned)total));
+        response->addHeader("Content-Disposition", "attachment; filename=\"actionlog.bin\"");
+        request->send(response);
+    });
+    // 強制門戶：各系統的連網偵測網址固定回應，其他網域的請求一律導向引導頁
+    for (int i = 0; i < CAPTIVE_PROBE_COUNT; i++) {
+        const CaptiveProbe* probe = &CAPTIVE_PROBES[i];
+        server.on(probe->path, HTTP_GET, [probe](AsyncWebServerRequest *r) { sendCaptive(r, *probe); });
+    }
+    server.on(CAPTIVE_LANDING_PATH, HTTP_GET, sendLanding);
+    server.onNotFound([](AsyncWebServerRequest *r) {
+        if (r->host() != apIP.toString()) r->redirect(CAPTIVE_LANDING_URL);
+        else r->send(404);
+    });
+    // 網頁於建置時以 gzip 壓縮存入 flash (見 tools/embed_web.py)，直接串流、不複製到 heap
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        String html = R"rawliteral(
-<!DOCTYPE html><html><head><meta charset="utf-8"><meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=1, user-scalable=no">
-<title>狼人殺 V1.4</title><style>
-body { font-family: sans-serif; background: #121212; color: white; text-align: center; margin: 0; padding: 10px; }
-.card { background: #1e1e1e; padding: 20px; border-radius: 15px; max-width: 400px; margin: 10px auto; border: 1px solid #333; }
-button { background: #2563eb; color: white; border: none; padding: 15px; border-radius: 10px; margin: 8px 0; width: 100%; font-size: 16px; font-weight: bold; }
-button:disabled { background: #555; }
-.hunter { background: #b91c1c; border: 2px solid white; }
-.hide { display: none; } .info { color: #facc15; }
-</style></head><body>
-<div class="card">
-    <div id="gameUI">
-        <h2 id="title">遊戲大廳</h2>
-        <div id="roleDisplay" style="color:#facc15; font-size:22px; font-weight:bold;"></div>
-        <div id="status" class="info"></div>
-        <div id="actions"></div>
-        <div id="hunterZone" class="hide">
-            <h3 style="color:#ef4444">⚠️ 獵人開槍技能</h3>
-            <div id="hunterActions"></div>
-        </div>
-    </div>
-    <div id="winUI" class="hide">
-        <h1 id="winMsg"></h1>
-        <button id="restartBtn">下一局準備</button>
-    </div>
-</div>
-<script>
-    let deviceId = localStorage.getItem('wid') || 'P' + Math.floor(Math.random()*1000000);
-    localStorage.setItem('wid', deviceId);
-    let ws = new WebSocket('ws://' + window.location.hostname + '/ws');
-    ws.onopen = () => ws.send(JSON.stringify({ action: "connect", deviceId: deviceId }));
-    ws.onmessage = (e) => {
-        const d = JSON.parse(e.data);
-        if (d.type === "seerResult") { alert("🔮 查驗結果：【" + d.role + "】"); return; }
-        
-        const gameUI = document.getElementById('gameUI');
-        const winUI = document.getElementById('winUI');
-        const restartBtn = document.getElementById('restartBtn');
-
-        if (d.gameOver) {
-            gameUI.classList.add('hide');
-            winUI.classList.remove('hide');
-            document.getElementById('winMsg').innerHTML = (d.winner === "WOLVES" ? "狼人" : "好人") + "獲勝";
-            
-            if (d.adminApproved) {
-                // V1.4 BUGFIX: 根據服務器狀態決定按鈕顯示
-                const hasVoted = d.votedPlayers && d.votedPlayers.includes(deviceId);
-                if (hasVoted) {
-                    restartBtn.innerHTML = '已準備，等待其他玩家...';
-                    restartBtn.disabled = true;
-                } else {
-                    restartBtn.innerHTML = '點此準備下一局';
-                    restartBtn.disabled = false;
-                    restartBtn.onclick = () => {
-                        act('restart', '');
-                    };
-                }
-            } else {
-                restartBtn.innerHTML = '遊戲結束 (等待主控)';
-                restartBtn.disabled = true;
-            }
+        if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == INDEX_HTML_ETAG) {
+            request->send(304);
             return;
         }
-
-        // V1.4 BUGFIX: 遊戲重新開始時，確保主介面顯示
-        if (gameUI.classList.contains('hide')) {
-            gameUI.classList.remove('hide');
-            winUI.classList.add('hide');
-        }
-        render(d);
-    };
-
-    function render(d) {
-        const area = document.getElementById('actions');
-        const hZone = document.getElementById('hunterZone');
-        const hActions = document.getElementById('hunterActions');
-        area.innerHTML = ""; hActions.innerHTML = ""; hZone.classList.add('hide');
-        document.getElementById('roleDisplay').innerHTML = d.role + " (" + d.index + "號)";
-        
-        let statusHtml = "";
-        // V1.5: 顯示昨晚死亡訊息
-        if (d.phase == 3 && d.deathNote) {
-            statusHtml += `<div class="info">${d.deathNote}</div>`;
-        }
-
-        // V1.4 BUGFIX: 顯示開局倒數
-        if (d.isStarting && d.countdown > 0) {
-            document.getElementById('title').innerHTML = "遊戲即將開始";
-            area.innerHTML = `<div style="font-size: 4em; font-weight: bold;">${d.countdown}</div>`;
-            document.getElementById('status').innerHTML = ""; // 倒數時清空狀態
-            return;
-        } 
-        // V1.6: 顯示等待玩家連線狀態 (Web)
-        else if (d.waitingForPlayers) {
-            document.getElementById('title').innerHTML = "等待玩家加入";
-            area.innerHTML = `<div style="font-size: 3em; font-weight: bold;">${d.currentCount} / ${d.targetCount}</div>`;
-            document.getElementById('status').innerHTML = "已確認人數，等待連線...";
-            return;
-        } else {
-            document.getElementById('title').innerHTML = "遊戲大廳";
-        }
-
-        if (d.isDead) {
-            let deadStatus = d.idiotRevealed ? "你已翻牌免死 (無投票權)" : "你已出局";
-            statusHtml += (statusHtml ? "<br>" : "") + deadStatus;
-            if (d.canShoot) {
-                hZone.classList.remove('hide');
-                d.targets.forEach(t => hActions.innerHTML += `<button class="hunter" onclick="act('hunterShoot','${t.id}')">射殺 ${t.index}號</button>`);
-            }
-            document.getElementById('status').innerHTML = statusHtml;
-            if (!d.idiotRevealed) return;
-        } else {
-            document.getElementById('status').innerHTML = statusHtml;
-        }
-        
-        if (d.isPhaseLocked && !d.hunterActionPending) { area.innerHTML = "🌙 天黑請閉眼..."; return; }
-        if (d.hunterActionPending) { area.innerHTML = "等待獵人行動..."; return; }
-
-
-        if (d.phase == 4 && d.role === "守衛") {
-            d.targets.forEach(t => {
-                if(t.id != d.lastGuardedId) area.innerHTML += `<button onclick="act('guardProtect','${t.id}')">守護 ${t.index}號</button>`;
-            });
-            area.innerHTML += `<button onclick="act('guardProtect','')">空守</button>`;
-        } else if (d.phase == 0 && d.role === "狼人") {
-            d.targets.forEach(t => area.innerHTML += `<button onclick="act('wolfKill','${t.id}')">獵殺 ${t.index}號</button>`);
-        } else if (d.phase == 1 && d.role === "預言家") {
-            d.targets.forEach(t => { if(t.index != d.index) area.innerHTML += `<button onclick="act('seerCheck','${t.id}')">查驗 ${t.index}號</button>`; });
-        } else if (d.phase == 2 && d.role === "女巫") {
-            if (d.hasHeal && d.wolfTargetIndex) area.innerHTML += `<button style="background:#16a34a" onclick="act('witchHeal','${d.wolfTargetId}')">救 ${d.wolfTargetIndex}號</button>`;
-            if (d.hasPoison) d.targets.forEach(t => area.innerHTML += `<button style="background:#dc2626" onclick="act('witchPoison','${t.id}')">毒殺 ${t.index}號</button>`);
-            area.innerHTML += `<button onclick="act('witchSkip','')">跳過</button>`;
-        } else if (d.phase == 3) {
-            if (!d.idiotRevealed) {
-                d.targets.forEach(t => area.innerHTML += `<button onclick="act('champExile','${t.id}')">放逐 ${t.index}號</button>`);
-                area.innerHTML += `<button onclick="act('champExile','')">棄票</button>`;
-            } else {
-                area.innerHTML = "你已翻牌，無法參與投票";
-            }
-        }
-    }
-    function act(a, t) { ws.send(JSON.stringify({ action: a, targetId: t, deviceId: deviceId })); }
-</script></body></html>
-)rawliteral";
-        request->send(200, "text/html", html);
+        AsyncWebServerResponse *res = request->beginResponse_P(200, "text/html", INDEX_HTML_GZ, INDEX_HTML_GZ_LEN);
+        res->addHeader("Content-Encoding", "gzip");
+        res->addHeader("ETag", INDEX_HTML_ETAG);
+        res->addHeader("Cache-Control", "no-cache"); // 每次都以 ETag 重新驗證，韌體更新後立即生效
+        request->send(res);
     });
     server.begin();
-    // --- 強制初始化顯示設定畫面 ---
-    gameStarted = false;
-    isStartingCountdown = false;
-    confirmPressed = false; 
-    
-    u8g2.clearBuffer();
-    syncGameState(); // 確保開機第一時間顯示 SET PLAYER 畫面
+    xTaskCreatePinnedToCore(gameTask, "game", GAME_TASK_STACK, nullptr, GAME_TASK_PRIO, &gameTaskHandle, GAME_TASK_CORE);
+    attachInterrupt(digitalPinToInterrupt(DF_BUSY_PIN), onBusyIdle, RISING);
+
+    attachInterrupt(digitalPinToInterrupt(JOYSTICK_SW), onJoystickEdge, CHANGE);
+    esp_timer_create_args_t sampler = {};
+    sampler.callback = sampleJoystick;
+    sampler.name = "joystick";
+    esp_timer_handle_t samplerTimer;
+    esp_timer_create(&sampler, &samplerTimer);
+    esp_timer_start_periodic(samplerTimer, Joystick::SAMPLE_MS * 1000);
 }
 
+// Arduino 工作只負責 OLED 繪製 (I2C 傳輸不佔用網路與遊戲工作)；連線清理在遊戲工作
 void loop() {
-    dnsServer.processNextRequest();
-    ws.cleanupClients();
-
-    // --- V1.4 新增：處理神職死亡延遲 (BUGFIX: 增加閉眼音效以完善假回合) ---
-    if (phaseDelayStartTime > 0 && (millis() - phaseDelayStartTime) >= 3000) { // 延遲3秒
-        int currentPhase = nightPhase;
-        phaseDelayStartTime = 0; // 清除計時器
-
-        unsigned long waitStart = 0; // 用於等待音效的超時計算
-
-        if (currentPhase == 4) { // 守衛死亡
-            playVoice(13, false); // 播放守衛閉眼
-            waitStart = millis();
-            while(digitalRead(DF_BUSY_PIN) == LOW && (millis() - waitStart < 5000)) { delay(10); } // 等待音效結束, 超時5秒
-            nightPhase = 0; 
-        } else if (currentPhase == 1) { // 預言家死亡
-            playVoice(5, false);  // 播放預言家閉眼
-            waitStart = millis();
-            while(digitalRead(DF_BUSY_PIN) == LOW && (millis() - waitStart < 5000)) { delay(10); }
-            nightPhase = 2;
-        } else if (currentPhase == 2) { // 女巫死亡
-            playVoice(8, false);  // 播放女巫閉眼
-            waitStart = millis();
-            while(digitalRead(DF_BUSY_PIN) == LOW && (millis() - waitStart < 5000)) { delay(10); }
-            if (wolfTargetId != "" && wolfTargetId != currentGuardedId) {
-                lastNightDeadPlayers.push_back(wolfTargetId); // V1.5: 記錄死者
-                deadPlayers.push_back(wolfTargetId);
-            }
-            nightPhase = 3;
-        }
-        
-        phaseStartTime = millis();
-        isPhaseLocked = true; // 確保能觸發下一階段的睜眼音效
-        syncGameState();
-    }
-    
-    // --- 1. 音效與非阻塞延遲處理 (V1.4 BUGFIX: 修正 BUSY PIN 邏輯) ---
-    if (isAudioPlaying && digitalRead(DF_BUSY_PIN) == HIGH) isAudioPlaying = false;
-    
-    if (isSeerCheckPending && (millis() - seerCheckDelayStart >= 5500)) {
-        isSeerCheckPending = false;
-        playVoice(5, true); 
-        nightPhase = 2; phaseStartTime = millis(); isPhaseLocked = true; syncGameState();
-    }
-
-    // --- 2. 遊戲進行中的狀態處理 ---
-    if (gameStarted && !gameOver && isPhaseLocked && !isSeerCheckPending && (millis() - phaseStartTime >= 2000)) {
-        if (digitalRead(DF_BUSY_PIN) == HIGH) { 
-            if (nightPhase == 4) playVoice(12, false);
-            else if (nightPhase == 0) playVoice(2, false);
-            else if (nightPhase == 1) playVoice(4, false);
-            else if (nightPhase == 2) playVoice(6, false);
-            else if (nightPhase == 3) playVoice(9, true);
-            isPhaseLocked = false;
-            syncGameState();
-        }
-    }
-
-    // --- 3. 人數設定與開局觸發 (解決鎖定 14 人與不顯示畫面的重點) ---
-    if (!gameStarted && !isStartingCountdown) {
-        if (!confirmPressed) {
-            // 讀取搖桿並增加死區 (Deadzone) 判斷，避免數值浮動
-            int xVal = analogRead(JOYSTICK_X);
-            bool swBtn = (digitalRead(JOYSTICK_SW) == LOW);
-
-            if (xVal > 3600 && targetPlayerCount < 15) { 
-                targetPlayerCount++; 
-                triggerBuzzer(1); 
-                delay(200); // 增加延遲避免跳太快
-                syncGameState();
-            }
-            else if (xVal < 400 && targetPlayerCount > 6) { 
-                targetPlayerCount--; 
-                triggerBuzzer(1); 
-                delay(200); 
-                syncGameState();
-            }
-            
-            if (swBtn) { 
-                confirmPressed = true; 
-                triggerBuzzer(2); 
-                delay(500); 
-                syncGameState();
-            }
-        } 
-        // 只有在 confirmPressed 之後，才判斷人數是否達標開局
-        else if (currentPlayerCount >= targetPlayerCount) {
-            setupRoles(); 
-            isStartingCountdown = true;
-            countdownStartTime = millis(); 
-            triggerBuzzer(2);
-            syncGameState();
-        }
-    }
-
-    // --- 4. 倒數計時與結束處理 ---
-    if (isStartingCountdown && (millis() - countdownStartTime >= 4000)) {
-        isStartingCountdown = false; 
-        gameStarted = true; 
-        // V1.4 MOD: 根據守衛是否存在決定夜晚的起始階段
-        if (isRoleAlive("守衛")) {
-            nightPhase = 4; // 有守衛從守衛開始
-        } else {
-            nightPhase = 0; // 無守衛則跳過，直接從狼人開始
-        }
-        playVoice(1, true); 
-        phaseStartTime = millis(); 
-        isPhaseLocked = true;
-        syncGameState();
-    }
-
-    if (gameOver && !adminApprovedReset && (digitalRead(JOYSTICK_SW) == LOW)) { 
-        adminApprovedReset = true;
-        restartVotes.clear();
-        delay(500); 
-        syncGameState();
-    }
-    
-    // --- 定時刷新 ---
-    if (!gameStarted) { // 在設定階段與倒數階段都進行刷新
-        static unsigned long lastOledRefresh = 0;
-        if (millis() - lastOledRefresh > 500) {
-            lastOledRefresh = millis();
-            syncGameState();
-        }
-    }
+    rooms.render();
 
     delay(10);
-}
\ No newline at end of file
+}
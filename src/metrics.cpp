@@ -0,0 +1,16 @@
+#include "metrics.h"
+#include <stdio.h>
+
+void Histogram::write(std::string& out, const char* name) const {
+    char line[96];
+    uint32_t cumulative = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        cumulative += counts[b];
+        if (b < BUCKETS - 1) snprintf(line, sizeof(line), "%s_bucket{le=\"%u\"} %u\n", name, 1u << b, cumulative);
+        else snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %u\n", name, cumulative);
+        out += line;
+    }
+    snprintf(line, sizeof(line), "%s_sum %llu\n%s_count %u\n%s_max %u\n", name, (unsigned long long)sum,
+             name, count, name, max);
+    out += line;
+}
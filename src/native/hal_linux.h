@@ -0,0 +1,151 @@
+/*
+ * =============================================================
+ * Linux 替身 (HAL stand-ins)
+ * -------------------------------------------------------------
+ * 以虛擬時間驅動：delay() 只推進時鐘，不真的睡眠，
+ * 因此整局遊戲的音效等待與階段延遲可在數毫秒內跑完。
+ * =============================================================
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include "hal.h"
+
+// --- 虛擬時鐘 ---
+class SimClock : public Clock {
+public:
+    unsigned long now = 0;
+    unsigned long millis() override { return now; }
+    unsigned long micros() override {               // 耗時量測取實際時間
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    void delay(unsigned long ms) override { now += ms; }
+    void advance(unsigned long ms) { now += ms; }
+};
+
+// --- 實際時間 (可加速)：program serve 使用；micros() 一律為實際時間 ---
+class RealClock : public Clock {
+public:
+    explicit RealClock(double speed = 1.0) : speed(speed), start(std::chrono::steady_clock::now()) {}
+    unsigned long millis() override { return (unsigned long)(micros() * speed / 1000); }
+    unsigned long micros() override {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    void delay(unsigned long ms) override { std::this_thread::sleep_for(std::chrono::microseconds((long)(ms * 1000 / speed))); }
+
+    const double speed;
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// --- DFPlayer 替身：每段音檔固定播放 trackMs 毫秒 ---
+class LinuxAudio : public AudioOut {
+public:
+    explicit LinuxAudio(Clock& clock, unsigned long trackMs = 1500) : clock(clock), trackMs(trackMs) {}
+    void play(int fileID) override { lastTrack = fileID; busyUntil = clock.millis() + trackMs; plays++; }
+    bool isBusy() override { return clock.millis() < busyUntil; }
+    void tone(int freq, int durationMs) override { tones++; }
+    bool wakesOnIdle() override { return true; }   // 驅動程式以 idleIn() 模擬 BUSY 中斷
+    unsigned long idleIn() { return isBusy() ? busyUntil - clock.millis() : 0; }
+
+    int lastTrack = 0;
+    unsigned long plays = 0, tones = 0;
+
+private:
+    Clock& clock;
+    unsigned long trackMs;
+    unsigned long busyUntil = 0;
+};
+
+// --- OLED 替身：只記錄畫面內容與送出次數 ---
+class LinuxDisplay : public Display {
+public:
+    void firstPage() override { screen.clear(); }
+    bool nextPage() override { frames++; return false; }
+    void drawStr(int x, int y, const char* s) override { screen += s; screen += '\n'; }
+    void setCursor(int x, int y) override {}
+    void print(const char* s) override { screen += s; }
+    void print(int v) override { screen += std::to_string(v); }
+
+    std::string screen;
+    unsigned long frames = 0;
+};
+
+// --- WebSocket 替身：訊框直接交給 sink ---
+class LinuxTransport : public Transport {
+public:
+    std::function<void(uint32_t, const char*, size_t, bool)> sink;
+    unsigned long frames = 0, bytes = 0, serialized = 0;
+
+    bool makeShared(SharedFrame& f, size_t len) override { serialized++; return Transport::makeShared(f, len); }
+
+    void text(uint32_t clientId, const char* data, size_t len) override {
+        frames++; bytes += len;
+        if (sink) sink(clientId, data, len, false);
+    }
+    void binary(uint32_t clientId, const uint8_t* data, size_t len) override {
+        frames++; bytes += len;
+        if (sink) sink(clientId, (const char*)data, len, true);
+    }
+    bool clientStats(uint32_t clientId, uint32_t& queued, uint32_t& dropped) override {
+        queued = 0; dropped = 0;                     // sink 為同步呼叫，沒有待送佇列
+        return true;
+    }
+};
+
+// --- 搖桿替身：驅動程式直接送出已去彈跳的事件 (取樣與去彈跳見 program input) ---
+class LinuxInput : public Input {
+public:
+    void press(InputEvent ev) { events.push_back(ev); }
+    bool pending() const { return !events.empty(); }
+    bool next(InputEvent& ev) override {
+        if (events.empty()) return false;
+        ev = events.front(); events.pop_front();
+        return true;
+    }
+
+private:
+    std::deque<InputEvent> events;
+};
+
+class LinuxSystem : public System {
+public:
+    explicit LinuxSystem(uint32_t seed) : rng(seed) {}
+    long random(long lo, long hi) override {
+        if (hi <= lo) return lo;
+        return std::uniform_int_distribution<long>(lo, hi - 1)(rng);
+    }
+    uint32_t freeHeap() override { return 0; }
+    void vlog(const char* fmt, va_list ap) override { if (verbose) vfprintf(stderr, fmt, ap); }
+
+    // 非揮發儲存替身：每個 key 一個檔案 (blobDir 為空則不支援)；寫入與 NVS 一樣直接覆蓋
+    size_t loadBlob(const char* key, void* buf, size_t cap) override {
+        if (blobDir.empty()) return 0;
+        FILE* f = fopen((blobDir + "/" + key).c_str(), "rb");
+        if (!f) return 0;
+        size_t n = fread(buf, 1, cap, f);
+        fclose(f);
+        return n;
+    }
+    bool saveBlob(const char* key, const void* data, size_t len) override {
+        if (blobDir.empty()) return false;
+        FILE* f = fopen((blobDir + "/" + key).c_str(), "wb");
+        if (!f) return false;
+        bool ok = fwrite(data, 1, len, f) == len;
+        return fclose(f) == 0 && ok;
+    }
+
+    bool verbose = false;
+    std::string blobDir;
+
+private:
+    std::mt19937 rng;
+};
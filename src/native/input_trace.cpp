@@ -0,0 +1,56 @@
+/*
+ * =============================================================
+ * 搖桿取樣重播 (program input <取樣檔|->)
+ * -------------------------------------------------------------
+ * 把實機記錄 (或手寫) 的搖桿原始取樣依時間餵給 Joystick，
+ * 印出去彈跳後產生的事件，用來調整門檻、遲滯與連發節奏。
+ * 每行一筆，# 開頭為註解：
+ *   <ms> <X 軸 0~4095> <按鍵 0|1>    週期取樣
+ *   <ms> edge                        按鍵中斷 (電位變化)
+ * =============================================================
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "joystick.h"
+
+static const char* eventName(InputEvent ev) {
+    switch (ev) {
+        case JOY_UP:     return "up";
+        case JOY_DOWN:   return "down";
+        case JOY_BUTTON: return "button";
+        default:         return "?";
+    }
+}
+
+int traceInput(const char* path) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) { fprintf(stderr, "cannot read %s\n", path); return 2; }
+    Joystick js;
+    unsigned long samples = 0, edges = 0, bad = 0, counts[4] = {};
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        unsigned long ms;
+        int x, sw;
+        char word[8];
+        if (sscanf(line, "%lu %7s", &ms, word) == 2 && strcmp(word, "edge") == 0) {
+            js.edge(ms);
+            edges++;
+            continue;
+        }
+        if (sscanf(line, "%lu %d %d", &ms, &x, &sw) != 3) { bad++; continue; }
+        js.sample(ms, x, sw != 0);
+        samples++;
+        InputEvent ev;
+        while (js.next(ev)) {
+            counts[ev]++;
+            printf("%8lu ms  %s\n", ms, eventName(ev));
+        }
+    }
+    if (f != stdin) fclose(f);
+    printf("samples=%lu edges=%lu events: up=%lu down=%lu button=%lu dropped=%u\n", samples, edges,
+           counts[JOY_UP], counts[JOY_DOWN], counts[JOY_BUTTON], js.dropped);
+    if (bad) printf("malformed lines=%lu\n", bad);
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * =============================================================
+ * 狼人殺引擎 - 開發機建置入口 ([env:native])
+ * -------------------------------------------------------------
+ * 以 Linux 替身執行完整遊戲引擎：模擬 N 支手機透過與網頁相同的
+ * connect / wolfKill / seerCheck / champExile ... 協定自動玩完多局，
+ * 並量測引擎在 broadcast()/onMessage()/loop() 上花費的時間。
+ *
+ * 用法：pio run -e native && .pio/build/native/program [人數] [局數] [亂數種子] [json|mp] [metrics|-] [紀錄檔]
+ *       .pio/build/native/program replay <紀錄檔>   (重播行動紀錄，見 replay.cpp)
+ *       .pio/build/native/program sim [每種人數局數] [執行緒數] [random|smart] [亂數種子] [角色池 ...] (見 sim.cpp)
+ *       .pio/build/native/program serve [埠號] [人數] [加速倍率] [桌數] [快照目錄] (WebSocket 伺服器，見 serve.cpp)
+ *       .pio/build/native/program input <取樣檔|->   (搖桿取樣重播，見 input_trace.cpp)
+ * =============================================================
+ */
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "protocol.h"
+#include "hal_linux.h"
+
+typedef std::chrono::steady_clock WallClock;
+
+int replayLog(const char* path);
+int simulate(int argc, char** argv);
+int serve(int argc, char** argv);
+int traceInput(const char* path);
+
+// --- 模擬玩家：與網頁相同，合併 update 快照與 delta 差量 ---
+struct Bot {
+    uint32_t clientId;
+    std::string deviceId;
+    int index = 0;                  // 玩家號碼 (seat 私訊)
+    DynamicJsonDocument state{4096};
+    bool fresh = false;
+    unsigned long resyncs = 0;
+};
+
+struct Bench {
+    SimClock clock;
+    LinuxAudio audio{clock};
+    LinuxDisplay display;
+    LinuxTransport transport;
+    LinuxInput input;
+    LinuxSystem sys;
+    Hal hal{audio, display, transport, input, clock, sys};
+    WerewolfGame game{hal};
+
+    std::vector<Bot> bots;
+    std::vector<Bot*> pending;      // 等待送出 resync 的玩家
+    std::mt19937 botRng;
+    bool useMsgPack = false;
+    WallClock::duration engineTime{0};
+    unsigned long engineCalls = 0;
+    unsigned long wakeups = 0;               // loop() 呼叫次數
+    unsigned long maxStallMs = 0;            // 單次引擎呼叫內推進的虛擬時間 (阻塞等待)
+
+    explicit Bench(uint32_t seed) : sys(seed), botRng(seed ^ 0x5A5A5A5Au) {
+        transport.sink = [this](uint32_t id, const char* data, size_t len, bool binary) {
+            if (id == 0 || id > bots.size()) return;
+            receive(bots[id - 1], data, len, binary);
+        };
+    }
+
+    // 與網頁相同：把 MessagePack 短標籤展開回 JSON 欄位名稱
+    static void expand(JsonObject src, JsonObject dst) {
+        for (JsonPair kv : src) {
+            const char* key = kv.key().c_str();
+            for (int k = K_TYPE; k < K_COUNT; k++) {
+                if (strcmp(WIRE_KEYS[k].tag, key) == 0) { key = WIRE_KEYS[k].json; break; }
+            }
+            JsonVariant v = kv.value();
+            if (strcmp(key, "type") == 0) {
+                for (int t = 0; t < MSG_TYPE_COUNT; t++) {
+                    if (v == MSG_TYPES[t].tag) { dst[key] = MSG_TYPES[t].json; break; }
+                }
+            } else if (strcmp(key, "role") == 0) {
+                dst[key] = roleName(v.as<int>());
+            } else if (strcmp(key, "targets") == 0) {
+                JsonArray out = dst.createNestedArray(key);
+                for (JsonVariant t : v.as<JsonArray>()) expand(t.as<JsonObject>(), out.createNestedObject());
+            } else {
+                dst[key] = v;
+            }
+        }
+    }
+
+    void receive(Bot& b, const char* data, size_t len, bool binary) {
+        DynamicJsonDocument d(4096);
+        if (binary) {
+            DynamicJsonDocument raw(4096);
+            if (deserializeMsgPack(raw, data, len)) return;
+            expand(raw.as<JsonObject>(), d.to<JsonObject>());
+        } else if (deserializeJson(d, data, len)) {
+            return;
+        }
+        std::string type = d["type"] | "";
+        if (type == "update") {
+            b.state.set(d);
+        } else if (type == "delta") {
+            if (b.state.isNull() || (d["base"] | 0u) != (b.state["v"] | 0u)) {
+                b.resyncs++;
+                pending.push_back(&b); // 與網頁相同：版本不連續時要求完整快照
+                return;
+            }
+            for (JsonPair kv : d.as<JsonObject>()) b.state[kv.key().c_str()] = kv.value();
+        } else if (type == "seat") {
+            b.index = d["index"] | 0;
+            return;
+        } else {
+            return; // seerResult 等私訊
+        }
+        b.fresh = true;
+    }
+
+    // 對應 ESP32 遊戲工作被喚醒一次
+    void step() {
+        auto t0 = WallClock::now();
+        unsigned long v0 = clock.now;
+        game.loop();
+        engineTime += WallClock::now() - t0; engineCalls++; wakeups++;
+        maxStallMs = std::max(maxStallMs, clock.now - v0);
+        game.oled().render(); // 對應 ESP32 Arduino 工作的繪製
+    }
+    // 睡到引擎要求的下一次喚醒 (計時器到期、語音需推進或讀取搖桿)，BUSY 轉閒視同中斷提早喚醒
+    void sleep() {
+        unsigned long wait = game.nextWakeMs();
+        if (audio.isBusy()) wait = std::min(wait, audio.idleIn());
+        clock.advance(std::max(1UL, wait));
+    }
+    void tick() { step(); sleep(); }
+
+    void send(Bot& b, const char* action, const std::string& targetId) {
+        StaticJsonDocument<256> doc;
+        std::string msg;
+        bool binary = useMsgPack && strcmp(action, "connect") != 0; // connect 一律以 JSON 協商
+        if (binary) {
+            doc[wireKey(K_ACTION, true)] = (int)actionFromName(action);
+            doc[wireKey(K_TARGET_ID, true)] = targetId;
+            doc[wireKey(K_DEVICE_ID, true)] = b.deviceId;
+            serializeMsgPack(doc, msg);
+        } else {
+            doc["action"] = action; doc["targetId"] = targetId; doc["deviceId"] = b.deviceId;
+            if (useMsgPack) doc["proto"] = "mp";
+            serializeJson(doc, msg);
+        }
+        auto t0 = WallClock::now();
+        unsigned long v0 = clock.now;
+        game.onMessage(b.clientId, msg.c_str(), msg.size(), binary);
+        engineTime += WallClock::now() - t0; engineCalls++;
+        maxStallMs = std::max(maxStallMs, clock.now - v0);
+    }
+
+    std::string pick(JsonArray targets, const std::string& exclude = "") {
+        std::vector<std::string> ids;
+        for (JsonVariant t : targets) {
+            std::string id = t["id"] | "";
+            if (id != exclude) ids.push_back(id);
+        }
+        if (ids.empty()) return "";
+        return ids[botRng() % ids.size()];
+    }
+
+    // 與網頁 render() 相同的判斷，回傳是否送出了動作
+    bool act(Bot& b) {
+        JsonDocument& d = b.state;
+        b.fresh = false;
+        JsonArray targets = d["targets"].as<JsonArray>();
+        std::string role = d["role"] | "";
+        int phase = d["phase"] | -1;
+
+        if (d["gameOver"] | false) {
+            if (!(d["adminApproved"] | false)) return false;
+            for (JsonVariant v : d["votedPlayers"].as<JsonArray>()) {
+                if (b.deviceId == (v | "")) return false;
+            }
+            send(b, "restart", "");
+            return true;
+        }
+        if ((d["isStarting"] | false) || (d["waitingForPlayers"] | false)) return false;
+        if (d["isDead"] | false) {
+            if ((d["canShoot"] | false) && (d["hunterActionPending"] | false)) {
+                send(b, "hunterShoot", pick(targets));
+                return true;
+            }
+            if (!(d["idiotRevealed"] | false)) return false;
+        }
+        if (d["isPhaseLocked"] | false) return false;
+        for (JsonVariant v : d["ballots"].as<JsonArray>()) {
+            if ((v | 0) == b.index) return false; // 本輪已投票
+        }
+
+        if (phase == 4 && role == "守衛") {
+            send(b, "guardProtect", pick(targets, d["lastGuardedId"] | ""));
+        } else if (phase == 0 && role == "狼人") {
+            send(b, "wolfKill", pick(targets));
+        } else if (phase == 1 && role == "預言家") {
+            send(b, "seerCheck", pick(targets, b.deviceId));
+        } else if (phase == 2 && role == "女巫") {
+            int r = botRng() % 3;
+            if (r == 0 && (d["hasHeal"] | false) && (d["wolfTargetIndex"] | 0)) send(b, "witchHeal", d["wolfTargetId"] | "");
+            else if (r == 1 && (d["hasPoison"] | false)) send(b, "witchPoison", pick(targets));
+            else send(b, "witchSkip", "");
+        } else if (phase == 3 && !(d["idiotRevealed"] | false)) {
+            send(b, "champExile", (botRng() % 8 == 0) ? std::string() : pick(targets));
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc > 2 && strcmp(argv[1], "replay") == 0) return replayLog(argv[2]);
+    if (argc > 1 && strcmp(argv[1], "sim") == 0) return simulate(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) return serve(argc - 2, argv + 2);
+    if (argc > 2 && strcmp(argv[1], "input") == 0) return traceInput(argv[2]);
+    int players = argc > 1 ? atoi(argv[1]) : 9;
+    int games = argc > 2 ? atoi(argv[2]) : 100;
+    uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 1;
+    bool msgpack = argc > 4 && strcmp(argv[4], "mp") == 0;
+    if (players < 6) players = 6;
+    if (players > 15) players = 15;
+
+    Bench bench(seed);
+    bench.useMsgPack = msgpack;
+    bench.game.begin();
+
+    // 主控端：以搖桿設定人數並確認
+    for (int i = 0; i < abs(players - 7); i++) { bench.input.press(players > 7 ? JOY_UP : JOY_DOWN); bench.tick(); }
+    bench.input.press(JOY_BUTTON); bench.tick();
+
+    bench.bots.resize(players);
+    for (int i = 0; i < players; i++) {
+        bench.bots[i].clientId = i + 1;
+        bench.bots[i].deviceId = "P" + std::to_string(100000 + i);
+    }
+    for (Bot& b : bench.bots) bench.send(b, "connect", "");
+
+    int wolves = 0, humans = 0, played = 0, stalled = 0;
+    unsigned long gameStart = bench.clock.millis();
+    bool sawOver = false;
+    while (played < games) {
+        bench.step();
+        while (!bench.pending.empty()) {
+            Bot* b = bench.pending.back(); bench.pending.pop_back();
+            bench.send(*b, "resync", "");
+        }
+        for (Bot& b : bench.bots) {
+            if (!b.fresh) continue;
+            if (!sawOver && (b.state["gameOver"] | false)) {
+                sawOver = true; played++;
+                if (std::string(b.state["winner"] | "") == "WOLVES") wolves++; else humans++;
+                bench.input.press(JOY_BUTTON); bench.tick(); // 主控同意續局
+            }
+            bench.act(b);
+        }
+        if (sawOver && !(bench.bots[0].state["gameOver"] | false)) {
+            sawOver = false; gameStart = bench.clock.millis();
+        }
+        if (bench.clock.millis() - gameStart > 4UL * 3600 * 1000) { stalled++; break; }
+        bench.sleep(); // 機器人已在收到狀態的同一刻行動，之後才睡
+    }
+
+    double us = std::chrono::duration<double, std::micro>(bench.engineTime).count();
+    printf("players=%d games=%d seed=%u proto=%s\n", players, played, seed, msgpack ? "mp" : "json");
+    printf("winners: WOLVES=%d HUMANS=%d stalled=%d\n", wolves, humans, stalled);
+    printf("engine: calls=%lu total=%.1f ms avg=%.2f us/call max stall=%lu ms\n", bench.engineCalls, us / 1000.0,
+           us / bench.engineCalls, bench.maxStallMs);
+    printf("syncs=%lu serialized=%lu frames=%lu bytes=%lu avg=%.1f B/frame\n", bench.game.oled().published,
+           bench.transport.serialized, bench.transport.frames, bench.transport.bytes,
+           bench.transport.frames ? (double)bench.transport.bytes / bench.transport.frames : 0.0);
+    unsigned long resyncs = 0;
+    for (Bot& b : bench.bots) resyncs += b.resyncs;
+    printf("resyncs=%lu\n", resyncs);
+    const Metrics& m = bench.game.metrics();
+    printf("sync serialize: avg=%.1f max=%u us  broadcast: avg=%.1f max=%u us  timer late max=%u ms\n",
+           m.syncSerializeUs.count ? (double)m.syncSerializeUs.sum / m.syncSerializeUs.count : 0.0, m.syncSerializeUs.max,
+           m.syncBroadcastUs.count ? (double)m.syncBroadcastUs.sum / m.syncBroadcastUs.count : 0.0, m.syncBroadcastUs.max,
+           m.timerLateMs.max);
+    if (argc > 5 && strcmp(argv[5], "metrics") == 0) printf("%s", bench.game.metrics().read().c_str());
+    printf("loop wakeups=%lu (%.1f/s virtual)\n", bench.wakeups, bench.wakeups * 1000.0 / bench.clock.millis());
+    printf("virtual time=%.1f min audio plays=%lu oled frames=%lu\n", bench.clock.millis() / 60000.0, bench.audio.plays,
+           bench.display.frames);
+    ActionLog& log = bench.game.actionLog();
+    printf("action log: records=%u dropped=%u\n", log.records, log.dropped);
+    if (argc > 6) {
+        std::string out;
+        log.dump(out);
+        FILE* f = fopen(argv[6], "wb");
+        if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) { fprintf(stderr, "cannot write %s\n", argv[6]); return 2; }
+        fclose(f);
+        printf("action log written: %s (%zu bytes)\n", argv[6], out.size());
+    }
+    return stalled ? 1 : 0;
+}
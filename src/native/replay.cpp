@@ -0,0 +1,246 @@
+/*
+ * =============================================================
+ * 行動紀錄重播 (program replay <紀錄檔>)
+ * -------------------------------------------------------------
+ * 讀取由 ESP32 /actionlog 下載 (或 bench 寫出) 的紀錄，依原本的時間與順序
+ * 把指令、搖桿與語音播完事件重新餵給引擎；引擎重播時產生的紀錄
+ * (含每次同步的狀態指紋) 必須與原始紀錄逐筆相同，否則回報第一個差異。
+ * 同時量測引擎耗時，可作為真實負載的基準測試。
+ * 紀錄完整 (未繞回、非由快照接續) 時從開機重播；否則從仍完整留在紀錄中的
+ * 最早檢查點 (開局或接續時寫入) 接續，之後的紀錄同樣逐筆比對。
+ * =============================================================
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "hal_linux.h"
+
+typedef std::chrono::steady_clock WallClock;
+
+// --- 語音：BUSY 何時轉閒由紀錄決定 ---
+class ReplayAudio : public AudioOut {
+public:
+    void play(int fileID) override { plays++; }
+    bool isBusy() override { return !idle; }
+    void tone(int freq, int durationMs) override {}
+    bool wakesOnIdle() override { return true; }
+    bool ready() override { return started; }       // 多桌時語音可能等喇叭，依紀錄決定何時開始
+
+    bool idle = false;
+    bool started = false;
+    unsigned long plays = 0;
+};
+
+// --- 亂數：依序交回紀錄中的洗牌種子 ---
+class ReplaySystem : public System {
+public:
+    long random(long lo, long hi) override {
+        if (seeds.empty()) { missing++; return lo; }
+        long s = seeds.front(); seeds.pop_front();
+        return s;
+    }
+    uint32_t freeHeap() override { return 0; }
+    void vlog(const char* fmt, va_list ap) override {}
+
+    std::deque<uint32_t> seeds;
+    unsigned long missing = 0;
+};
+
+struct Replay {
+    SimClock clock;
+    ReplayAudio audio;
+    LinuxDisplay display;
+    LinuxTransport transport;
+    LinuxInput input;
+    ReplaySystem sys;
+    Hal hal{audio, display, transport, input, clock, sys};
+    WerewolfGame game{hal};
+};
+
+static const char* recordName(uint8_t type) {
+    switch (type) {
+        case LOG_COMMAND: return "command";
+        case LOG_LOOP:    return "loop";
+        case LOG_SEED:    return "seed";
+        case LOG_STATE:   return "state";
+        case LOG_RESUME:  return "resume";
+        case LOG_CHECKPOINT: return "checkpoint";
+        default:          return "?";
+    }
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+    return true;
+}
+
+// 座位編號以引擎當下的座位表解回 deviceId (紀錄時引擎的座位表與此刻相同)
+static bool decodeCommand(const LogEntry& e, const PlayerTable& seats, Command& cmd) {
+    const uint8_t* p = e.payload;
+    const uint8_t* end = p + e.len;
+    uint32_t clientId;
+    if (!LogReader::readVarint(p, end, clientId) || end - p < 2) return false;
+    cmd.clientId = clientId;
+    cmd.action = (Action)*p++;
+    cmd.binary = (*p & CMD_BINARY) != 0;
+    cmd.wantsMsgPack = (*p & CMD_WANTS_MSGPACK) != 0;
+    p++;
+    int seat;
+    if (!LogReader::readId(p, end, seat, cmd.deviceId)) return false;
+    if (seat >= seats.count) return false;
+    if (seat >= 0) strcpy(cmd.deviceId, seats.idOf(seat));
+    if (!LogReader::readId(p, end, seat, cmd.targetId)) return false;
+    if (seat >= seats.count) return false;
+    if (seat >= 0) strcpy(cmd.targetId, seats.idOf(seat));
+    return true;
+}
+
+int replayLog(const char* path) {
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) { fprintf(stderr, "cannot read %s\n", path); return 2; }
+    LogReader reader;
+    if (!reader.open(data.data(), data.size())) {
+        if (reader.truncated) {
+            fprintf(stderr, "%s: incomplete export (%zu of %u bytes); the log wrapped during the download\n", path,
+                    data.size() - ActionLog::HEADER_LEN, reader.expected);
+        } else {
+            fprintf(stderr, "%s: not an action log\n", path);
+        }
+        return 2;
+    }
+
+    std::vector<LogEntry> all;
+    LogEntry e;
+    size_t from = 0;                                // 接續處 (最後一次由快照接續之後)
+    while (reader.next(e)) {
+        all.push_back(e);
+        if (e.type == LOG_RESUME) from = all.size();
+    }
+
+    // 起點：紀錄完整則從開機，否則從 from 之後第一個完整的檢查點
+    std::vector<uint8_t> checkpoint;
+    size_t start = 0;
+    bool fromBoot = !reader.dropped && from == 0;
+    if (!fromBoot) {
+        int expect = 0;
+        for (size_t i = from; i < all.size(); i++) {
+            const LogEntry& c = all[i];
+            if (c.type != LOG_CHECKPOINT || c.len < 2) continue;
+            if (c.payload[0] == 0) { checkpoint.clear(); expect = 0; }
+            if (c.payload[0] != expect) { checkpoint.clear(); expect = 0; continue; } // 前段已被覆蓋
+            checkpoint.insert(checkpoint.end(), c.payload + 2, c.payload + c.len);
+            expect++;
+            if (expect == c.payload[1]) { start = i + 1; break; }
+        }
+        if (!start) {
+            fprintf(stderr, "%s: %s and no complete checkpoint remains; nothing to replay from\n", path,
+                    from ? "game resumed from a snapshot" : "log wrapped");
+            return 2;
+        }
+    }
+
+    Replay* r = new Replay; // 紀錄緩衝較大，不放在堆疊上
+    std::vector<LogEntry> entries(all.begin() + start, all.end());
+    for (const LogEntry& le : entries) {
+        if (le.type == LOG_SEED) {
+            const uint8_t* p = le.payload;
+            uint32_t seed;
+            if (LogReader::readVarint(p, p + le.len, seed)) r->sys.seeds.push_back(seed);
+        }
+    }
+    if (entries.empty()) { fprintf(stderr, "%s: empty log\n", path); delete r; return 2; }
+
+    WallClock::duration engineTime{0};
+    unsigned long commands = 0, loops = 0, bad = 0;
+    auto t0 = WallClock::now();
+    if (fromBoot) {
+        r->clock.now = entries[0].time;
+        r->game.begin();
+    } else {
+        r->clock.now = all[start - 1].time;
+        if (!r->game.restoreCheckpoint(checkpoint.data(), checkpoint.size())) {
+            fprintf(stderr, "%s: checkpoint at %u ms is unreadable\n", path, all[start - 1].time);
+            delete r;
+            return 2;
+        }
+        printf("replay: starting from checkpoint at %u ms (%zu earlier records skipped, %u dropped)\n",
+               all[start - 1].time, start, reader.dropped);
+    }
+    engineTime += WallClock::now() - t0;
+    for (const LogEntry& le : entries) {
+        if (le.type != LOG_COMMAND && le.type != LOG_LOOP) continue; // 種子已預先取出；其餘由引擎重新產生
+        if (le.time > r->clock.now) r->clock.now = le.time;
+        if (le.type == LOG_COMMAND) {
+            Command cmd;
+            if (!decodeCommand(le, r->game.table(), cmd)) { bad++; continue; }
+            t0 = WallClock::now();
+            r->game.handleCommand(cmd);
+            engineTime += WallClock::now() - t0;
+            commands++;
+        } else {
+            if (le.len < 2) { bad++; continue; }
+            uint8_t flags = le.payload[1];
+            if (flags & LOOP_AXIS_UP) r->input.press(JOY_UP);
+            else if (flags & LOOP_AXIS_DOWN) r->input.press(JOY_DOWN);
+            else if (flags & LOOP_BUTTON) r->input.press(JOY_BUTTON);
+            r->audio.idle = (flags & LOOP_CUE_DONE) != 0;
+            r->audio.started = (flags & LOOP_CUE_STARTED) != 0;
+            t0 = WallClock::now();
+            r->game.loop();
+            engineTime += WallClock::now() - t0;
+            r->audio.idle = r->audio.started = false;
+            loops++;
+        }
+    }
+
+    // 比對：重播產生的紀錄與原始紀錄逐筆相同 (時間除外)
+    std::string replayed;
+    r->game.actionLog().dump(replayed);
+    LogReader again;
+    again.open((const uint8_t*)replayed.data(), replayed.size());
+    size_t index = 0, retimed = 0;
+    long mismatch = -1;
+    LogEntry a;
+    for (; index < entries.size(); index++) {
+        const LogEntry& o = entries[index];
+        if (!again.next(a) || a.type != o.type || a.len != o.len || memcmp(a.payload, o.payload, a.len) != 0) {
+            mismatch = (long)index;
+            break;
+        }
+        if (a.time != o.time) retimed++;
+    }
+    bool extra = mismatch < 0 && again.next(a);
+
+    double us = std::chrono::duration<double, std::micro>(engineTime).count();
+    printf("replay: %s records=%zu commands=%lu loops=%lu seeds=%zu span=%.1f min\n", path, entries.size(),
+           commands, loops, (size_t)std::count_if(entries.begin(), entries.end(), [](const LogEntry& x) { return x.type == LOG_SEED; }),
+           (entries.back().time - entries[0].time) / 60000.0);
+    printf("engine: total=%.1f ms avg=%.2f us/call syncs=%lu frames=%lu\n", us / 1000.0,
+           us / (commands + loops + 1), r->game.oled().published, r->transport.frames);
+    if (bad || r->sys.missing) printf("malformed records=%lu missing seeds=%lu\n", bad, r->sys.missing);
+    int rc = 0;
+    if (mismatch >= 0) {
+        const LogEntry& o = entries[mismatch];
+        printf("DIVERGED at record %ld (%s @ %u ms)\n", mismatch, recordName(o.type), o.time);
+        rc = 1;
+    } else if (extra) {
+        printf("DIVERGED: replay produced extra records after %zu\n", entries.size());
+        rc = 1;
+    } else {
+        printf("MATCH: %zu records identical (%zu with shifted time), final digest %08x\n", entries.size(), retimed,
+               r->game.stateDigest());
+    }
+    delete r;
+    return rc;
+}
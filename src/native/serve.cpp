@@ -0,0 +1,89 @@
+/*
+ * =============================================================
+ * 開發機遊戲伺服器 (program serve [埠號] [人數] [加速倍率] [桌數] [快照目錄])
+ * -------------------------------------------------------------
+ * 以實際時間執行引擎並透過 WsServer 提供 /ws 與網頁，
+ * 供瀏覽器或 tools/loadgen.py 連線。主控按鍵視同保持按下：
+ * 開機即依序確認各桌人數，每局結束自動同意續局。
+ * 加速倍率只影響遊戲時間 (語音長度、睜眼延遲、倒數)，不影響延遲量測。
+ * 指定快照目錄時以檔案代替 NVS：中止後以相同目錄重新啟動即接續該局。
+ * =============================================================
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "room.h"
+#include "hal_linux.h"
+#include "ws_server.h"
+
+int serve(int argc, char** argv) {
+    int port = argc > 0 ? atoi(argv[0]) : 8080;
+    int players = argc > 1 ? atoi(argv[1]) : 15;
+    double speed = argc > 2 ? atof(argv[2]) : 1.0;
+    int roomCount = argc > 3 ? atoi(argv[3]) : 1;
+    const char* snapshotDir = argc > 4 ? argv[4] : "";
+    players = std::max(6, std::min(15, players));
+    if (speed <= 0) speed = 1.0;
+
+    RealClock clock(speed);
+    LinuxAudio audio(clock);
+    LinuxDisplay display;
+    WsServer server;
+    LinuxInput input;
+    LinuxSystem sys((uint32_t)time(nullptr));
+    sys.blobDir = snapshotDir;
+    Hal hal{audio, display, server, input, clock, sys};
+    RoomSet* rooms = new RoomSet(hal, roomCount); // 行動紀錄緩衝較大，不放在堆疊上
+
+    if (!server.listen((uint16_t)port)) { perror("listen"); return 2; }
+    server.onMessage = [rooms](uint32_t id, const char* data, size_t len, bool binary) {
+        Command cmd;
+        if (parseCommand(id, data, len, binary, cmd)) rooms->handleCommand(cmd);
+    };
+    server.onClose = [rooms](uint32_t id) {
+        Command cmd;
+        cmd.clientId = id;
+        cmd.action = ACT_DISCONNECT;
+        rooms->handleCommand(cmd);
+    };
+    server.onWatch = [rooms](int channel) {
+        Command cmd;
+        cmd.action = ACT_WATCH;
+        cmd.room = (uint8_t)(channel + 1);
+        rooms->handleCommand(cmd);
+    };
+
+    // 搖桿只作用於主控桌；確認人數後主控自動換到下一桌
+    rooms->begin();
+    for (int r = 0; r < rooms->count(); r++) {
+        rooms->loop(); // 主控換到下一個需要設定的桌
+        if (!rooms->game(rooms->focus()).needsAdmin()) break; // 其餘皆由快照接續
+        for (int i = 0; i < abs(players - 7); i++) { input.press(players > 7 ? JOY_UP : JOY_DOWN); rooms->loop(); }
+        input.press(JOY_BUTTON);
+        rooms->loop();
+    }
+    printf("serving http://0.0.0.0:%d/ and ws://0.0.0.0:%d/ws players=%d speed=%.1fx rooms=%d\n", port, port, players,
+           speed, rooms->count());
+    fflush(stdout);
+
+    unsigned long lastReport = clock.micros();
+    for (;;) {
+        // 主控桌等待確認人數或同意續局：送出按鍵 (與實機按住按鍵時的重複事件相同)
+        if (!input.pending() && rooms->game(rooms->focus()).needsAdmin()) input.press(JOY_BUTTON);
+        unsigned long wait = rooms->loop();
+        if (audio.isBusy()) wait = std::min(wait, audio.idleIn());
+        server.poll((int)std::ceil(wait / speed));
+        rooms->render();
+        if (clock.micros() - lastReport >= 10000000UL) { // 每 10 秒摘要一次
+            lastReport = clock.micros();
+            unsigned long syncs = 0;
+            for (int r = 0; r < rooms->count(); r++) syncs += rooms->game(r).oled().published;
+            printf("connects=%lu frames=%lu bytes=%lu syncs=%lu dns=%lu probes=%lu\n", server.connects, server.frames,
+                   server.bytes, syncs, server.dnsQueries, server.probes);
+            fflush(stdout);
+        }
+    }
+}
@@ -0,0 +1,315 @@
+/*
+ * =============================================================
+ * 角色池平衡模擬 (program sim ...)
+ * -------------------------------------------------------------
+ * 以真正的引擎規則 (handleCommand / loop) 跑大量對局，統計 6-15 人
+ * 在各角色池下的狼人/好人勝率：
+ *   - 玩家以 clientId 0 入座，不建立連線，也不序列化任何訊框；不寫行動紀錄
+ *   - 策略直接讀取引擎的唯讀狀態：random (與 bench 機器人相同) 或 smart
+ *   - 工作以 (角色池, 人數, 區段) 切分，各執行緒以原子索引領取；
+ *     每個區段有自己的種子，結果與執行緒數無關，只以原子加法彙總
+ *   - 局數與每秒局數只計分出勝負的局；逾時卡住的局另列 stalled
+ *
+ * 用法：program sim [每種人數局數] [執行緒數] [random|smart] [亂數種子] [角色池 ...]
+ *       角色池格式見 role_pool.h；未指定時使用預設池
+ * =============================================================
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "game.h"
+#include "hal_linux.h"
+
+typedef std::chrono::steady_clock WallClock;
+
+enum Policy { POLICY_RANDOM, POLICY_SMART };
+
+static const int MIN_PLAYERS = 6, MAX_PLAYERS = 15;
+static const int SIZES = MAX_PLAYERS - MIN_PLAYERS + 1;
+static const uint32_t CHUNK = 250;                      // 每個工作的局數
+static const unsigned long STALL_MS = 2UL * 3600 * 1000; // 單局虛擬時間上限
+
+// 各執行緒只做原子加法，不需加鎖
+struct Tally {
+    std::atomic<uint32_t> games{0}, wolves{0}, humans{0}, stalled{0};
+    std::atomic<uint64_t> rounds{0};
+};
+
+struct Task {
+    int pool;
+    int players;
+    uint32_t games;
+    uint32_t seed;
+};
+
+// --- 一張桌子：一套替身 HAL + 引擎，連續玩多局 ---
+class SimTable {
+public:
+    SimTable(const RolePool& pool, int players, uint32_t seed, Policy policy)
+        : sys(seed), rng(seed ^ 0x9E3779B9u), policy(policy), players(players) {
+        game.setRolePool(pool);
+        game.setMetricsPeriod(0); // 每虛擬秒整理一次文字快照會佔掉大半時間
+        game.setJournaling(false); // 沒有人重播：省下每個指令的紀錄與鎖 (緩衝區也不會被碰到)
+        game.begin();
+        // 主控端：以搖桿設定人數並確認 (與實機相同的路徑)
+        for (int i = 0; i < abs(players - 7); i++) { input.press(players > 7 ? JOY_UP : JOY_DOWN); tick(); }
+        input.press(JOY_BUTTON); tick();
+        for (int seat = 0; seat < players; seat++) {
+            snprintf(ids[seat], sizeof(ids[seat]), "S%d", seat);
+            send(ACT_CONNECT, seat, -1);
+        }
+    }
+
+    // 玩完一局；回傳 false 表示逾時 (卡住)
+    bool play(bool& humansWon, int& rounds) {
+        known = 0; checked = 0;
+        unsigned long start = clock.now;
+        while (!game.isOver()) {
+            if (clock.now - start > STALL_MS) return false;
+            tick();
+            act();
+        }
+        humansWon = game.humansWon();
+        rounds = game.round();
+        // 主控同意續局，全體投票後自動開下一局
+        input.press(JOY_BUTTON); tick();
+        for (int seat = 0; seat < players; seat++) send(ACT_RESTART, seat, -1);
+        return true;
+    }
+
+private:
+    SimClock clock;
+    LinuxAudio audio{clock};
+    LinuxDisplay display;
+    LinuxTransport transport;
+    LinuxInput input;
+    LinuxSystem sys;
+    Hal hal{audio, display, transport, input, clock, sys};
+    WerewolfGame game{hal};
+
+    std::mt19937 rng;
+    Policy policy;
+    int players;
+    char ids[PlayerTable::CAPACITY][12];
+    PlayerTable::Mask known = 0;     // smart：預言家已公開的狼人
+    PlayerTable::Mask checked = 0;   // smart：已查驗過的座位
+
+    void tick() {
+        game.loop();
+        unsigned long wait = game.nextWakeMs();
+        if (audio.isBusy()) wait = std::min(wait, audio.idleIn());
+        clock.advance(std::max(1UL, wait));
+    }
+
+    void send(Action action, int seat, int target) {
+        Command cmd;
+        cmd.action = action;
+        strcpy(cmd.deviceId, ids[seat]);
+        strcpy(cmd.targetId, target >= 0 ? ids[target] : "");
+        game.handleCommand(cmd);
+    }
+
+    // 從遮罩中隨機挑一個座位 (空遮罩回傳 -1)
+    int pick(PlayerTable::Mask m) {
+        int n = PlayerTable::popcount(m);
+        if (n == 0) return -1;
+        int k = rng() % n;
+        for (int seat = 0; seat < PlayerTable::CAPACITY; seat++) {
+            if ((m & PlayerTable::bit(seat)) && k-- == 0) return seat;
+        }
+        return -1;
+    }
+
+    // 可選目標：存活且已入座 (與網頁的 targets 相同)
+    PlayerTable::Mask targets() const {
+        const PlayerTable& t = game.table();
+        PlayerTable::Mask m = 0;
+        for (int seat = 0; seat < t.count; seat++) {
+            if (t.index[seat] && t.isAlive(seat)) m |= PlayerTable::bit(seat);
+        }
+        return m;
+    }
+
+    int actor(Role r) const { return firstSeat(game.table().roleMask[r] & game.table().aliveMask); }
+    static int firstSeat(PlayerTable::Mask m) { return m ? __builtin_ctz(m) : -1; }
+
+    void act() {
+        const PlayerTable& t = game.table();
+        PlayerTable::Mask all = targets();
+        PlayerTable::Mask wolves = t.roleMask[ROLE_WOLF];
+        bool smart = (policy == POLICY_SMART);
+
+        if (game.awaitingHunter()) {
+            int hunter = firstSeat(t.roleMask[ROLE_HUNTER] & ~t.aliveMask);
+            if (hunter < 0 || !game.hunterCanShootNow()) return;
+            int target = smart && (known & all) ? pick(known & all) : pick(all & ~(smart ? checked : 0));
+            send(ACT_HUNTER_SHOOT, hunter, target < 0 ? pick(all) : target);
+            return;
+        }
+        if (!game.awaitingAction()) return;
+
+        int seat;
+        switch (game.phase()) {
+        case 4:
+            if ((seat = actor(ROLE_GUARD)) < 0) return;
+            {
+                int last = game.lastGuarded();
+                PlayerTable::Mask m = all & ~(last >= 0 ? PlayerTable::bit(last) : 0); // 不可連守
+                int seer = actor(ROLE_SEER);
+                bool guardSeer = smart && known && seer >= 0 && seer != last;
+                send(ACT_GUARD_PROTECT, seat, guardSeer ? seer : pick(m));
+            }
+            break;
+        case 0: {
+            // 每隻存活狼人各投一票；smart 狼人統一目標
+            const VoteBox& vote = game.votes();
+            int seer = actor(ROLE_SEER);
+            int shared = (known && seer >= 0) ? seer : pick(all & ~wolves); // 已跳的預言家優先
+            for (PlayerTable::Mask m = vote.eligible & ~vote.cast; m; m &= m - 1) {
+                send(ACT_WOLF_KILL, firstSeat(m), smart ? shared : pick(all));
+            }
+            break;
+        }
+        case 1:
+            if ((seat = actor(ROLE_SEER)) < 0) return;
+            {
+                PlayerTable::Mask m = all & ~PlayerTable::bit(seat) & ~(smart ? checked : 0);
+                int target = pick(m ? m : all & ~PlayerTable::bit(seat));
+                if (smart && target >= 0) {
+                    checked |= PlayerTable::bit(target);
+                    if (t.role[target] == ROLE_WOLF) known |= PlayerTable::bit(target);
+                }
+                send(ACT_SEER_CHECK, seat, target);
+            }
+            break;
+        case 2:
+            if ((seat = actor(ROLE_WITCH)) < 0) return;
+            if (smart) {
+                if (game.witchCanHeal() && game.wolfTarget() >= 0) send(ACT_WITCH_HEAL, seat, game.wolfTarget());
+                else if (game.witchCanPoison() && (known & all)) send(ACT_WITCH_POISON, seat, pick(known & all));
+                else send(ACT_WITCH_SKIP, seat, -1);
+            } else {
+                int r = rng() % 3;
+                if (r == 0 && game.witchCanHeal() && game.wolfTarget() >= 0) send(ACT_WITCH_HEAL, seat, game.wolfTarget());
+                else if (r == 1 && game.witchCanPoison()) send(ACT_WITCH_POISON, seat, pick(all));
+                else send(ACT_WITCH_SKIP, seat, -1);
+            }
+            break;
+        case 3: {
+            // 白天：每名有投票權的玩家各投一票
+            const VoteBox& vote = game.votes();
+            for (PlayerTable::Mask v = vote.eligible & ~vote.cast; v; v &= v - 1) {
+                int voter = firstSeat(v);
+                int target;
+                if (!smart) {
+                    target = (rng() % 8 == 0) ? -1 : pick(all);
+                } else if (t.role[voter] == ROLE_WOLF) {
+                    target = pick(all & ~wolves);
+                } else if (known & all) {
+                    target = pick(known & all);
+                } else {
+                    PlayerTable::Mask m = all & ~checked & ~PlayerTable::bit(voter);
+                    target = pick(m ? m : all & ~PlayerTable::bit(voter));
+                }
+                send(ACT_CHAMP_EXILE, voter, target);
+            }
+            break;
+        }
+        }
+    }
+};
+
+static uint32_t mixSeed(uint32_t a, uint32_t b) {
+    uint32_t h = a * 0x9E3779B1u ^ (b + 0x7F4A7C15u);
+    h ^= h >> 16; h *= 0x85EBCA6Bu; h ^= h >> 13; h *= 0xC2B2AE35u; h ^= h >> 16;
+    return h;
+}
+
+int simulate(int argc, char** argv) {
+    uint32_t perSize = argc > 0 ? (uint32_t)strtoul(argv[0], nullptr, 10) : 10000;
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    Policy policy = (argc > 2 && strcmp(argv[2], "smart") == 0) ? POLICY_SMART : POLICY_RANDOM;
+    uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 1;
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<RolePool> pools;
+    for (int i = 4; i < argc; i++) {
+        RolePool p;
+        if (!p.parse(argv[i])) { fprintf(stderr, "bad role pool: %s\n", argv[i]); return 2; }
+        pools.push_back(p);
+    }
+    if (pools.empty()) pools.push_back(RolePool::standard());
+
+    std::vector<Task> tasks;
+    for (int p = 0; p < (int)pools.size(); p++) {
+        for (int n = MIN_PLAYERS; n <= MAX_PLAYERS; n++) {
+            for (uint32_t done = 0, chunk = 0; done < perSize; done += CHUNK, chunk++) {
+                uint32_t games = std::min(CHUNK, perSize - done);
+                tasks.push_back({p, n, games, mixSeed(seed, (uint32_t)tasks.size())});
+            }
+        }
+    }
+
+    std::unique_ptr<Tally[]> tally(new Tally[pools.size() * SIZES]);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < tasks.size()) {
+            const Task& task = tasks[i];
+            Tally& out = tally[task.pool * SIZES + task.players - MIN_PLAYERS];
+            uint32_t wolves = 0, humans = 0, stalled = 0;
+            uint64_t rounds = 0;
+            std::unique_ptr<SimTable> table(new SimTable(pools[task.pool], task.players, task.seed, policy));
+            for (uint32_t g = 0; g < task.games; g++) {
+                bool humansWon; int r;
+                if (!table->play(humansWon, r)) {
+                    stalled++; // 卡住的桌子直接換新
+                    table.reset(new SimTable(pools[task.pool], task.players, mixSeed(task.seed, g), policy));
+                    continue;
+                }
+                (humansWon ? humans : wolves)++;
+                rounds += r;
+            }
+            out.games.fetch_add(wolves + humans, std::memory_order_relaxed);
+            out.wolves.fetch_add(wolves, std::memory_order_relaxed);
+            out.humans.fetch_add(humans, std::memory_order_relaxed);
+            out.stalled.fetch_add(stalled, std::memory_order_relaxed);
+            out.rounds.fetch_add(rounds, std::memory_order_relaxed);
+        }
+    };
+
+    auto t0 = WallClock::now();
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) pool.emplace_back(worker);
+    for (std::thread& t : pool) t.join();
+    double sec = std::chrono::duration<double>(WallClock::now() - t0).count();
+
+    uint64_t total = 0, stalled = 0;
+    for (size_t p = 0; p < pools.size(); p++) {
+        char spec[256];
+        pools[p].format(spec, sizeof(spec));
+        printf("pool %zu: %s\n", p, spec);
+        printf("  players    games  wolves%%  humans%%  rounds  stalled\n");
+        for (int n = MIN_PLAYERS; n <= MAX_PLAYERS; n++) {
+            Tally& t = tally[p * SIZES + n - MIN_PLAYERS];
+            uint32_t decided = t.wolves + t.humans;
+            printf("  %7d %8u %8.1f %8.1f %7.2f %8u\n", n, t.games.load(),
+                   decided ? 100.0 * t.wolves / decided : 0.0, decided ? 100.0 * t.humans / decided : 0.0,
+                   decided ? (double)t.rounds / decided : 0.0, t.stalled.load());
+            total += t.games;
+            stalled += t.stalled;
+        }
+    }
+    printf("policy=%s seed=%u threads=%d games=%llu stalled=%llu time=%.2f s throughput=%.0f games/s\n",
+           policy == POLICY_SMART ? "smart" : "random", seed, threads, (unsigned long long)total,
+           (unsigned long long)stalled, sec, total / sec);
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include "ws_server.h"
+#include "captive_portal.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+const int WsServer::PING_MS; // std::min() 以參考取用，需要類別外定義
+
+// --- 握手用 SHA-1 與 Base64 (RFC 6455 §4.2.2) ---
+
+static void sha1(const uint8_t* data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string msg((const char*)data, len);
+    uint64_t bits = (uint64_t)len * 8;
+    msg += (char)0x80;
+    while (msg.size() % 64 != 56) msg += (char)0;
+    for (int i = 7; i >= 0; i--) msg += (char)(bits >> (8 * i));
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t off = 0; off < msg.size(); off += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = (const uint8_t*)msg.data() + off + 4 * i;
+            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 20; i++) out[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+static std::string base64(const uint8_t* data, size_t len) {
+    static const char* T = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16 | (i + 1 < len ? data[i + 1] << 8 : 0) | (i + 2 < len ? data[i + 2] : 0);
+        out += T[(v >> 18) & 63]; out += T[(v >> 12) & 63];
+        out += (i + 1 < len) ? T[(v >> 6) & 63] : '=';
+        out += (i + 2 < len) ? T[v & 63] : '=';
+    }
+    return out;
+}
+
+// 取出 HTTP 標頭值 (名稱不分大小寫)
+static std::string header(const std::string& req, const char* name) {
+    size_t n = strlen(name);
+    for (size_t pos = req.find("\r\n"); pos != std::string::npos && pos + 2 < req.size(); pos = req.find("\r\n", pos + 2)) {
+        const char* line = req.c_str() + pos + 2;
+        if (strncasecmp(line, name, n) == 0 && line[n] == ':') {
+            size_t start = pos + 2 + n + 1, end = req.find("\r\n", start);
+            while (start < end && req[start] == ' ') start++;
+            return req.substr(start, end - start);
+        }
+    }
+    return "";
+}
+
+// --- 伺服器 ---
+
+WsServer::~WsServer() {
+    for (auto& cp : conns) ::close(cp.second.fd);
+    if (listenFd >= 0) ::close(listenFd);
+    if (dnsFd >= 0) ::close(dnsFd);
+}
+
+bool WsServer::listen(uint16_t port) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 128) < 0) return false;
+    fcntl(listenFd, F_SETFL, O_NONBLOCK);
+
+    // 強制門戶 DNS：綁不到 (埠號已被佔用) 時只是不提供
+    dnsFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (dnsFd >= 0 && bind(dnsFd, (sockaddr*)&addr, sizeof(addr)) < 0) { ::close(dnsFd); dnsFd = -1; }
+    if (dnsFd >= 0) fcntl(dnsFd, F_SETFL, O_NONBLOCK);
+
+    // 偵測網址的回應只組一次
+    const char* nocache = "Cache-Control: no-store\r\nConnection: close\r\n";
+    char head[256];
+    snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: %zu\r\n%s\r\n",
+             CAPTIVE_LANDING_LEN, nocache);
+    std::string landing = std::string(head) + CAPTIVE_LANDING_HTML;
+    snprintf(head, sizeof(head), "HTTP/1.1 302 Found\r\nLocation: %s\r\nContent-Length: 0\r\n%s\r\n", CAPTIVE_LANDING_URL,
+             nocache);
+    for (int i = 0; i < CAPTIVE_PROBE_COUNT; i++) {
+        portal[CAPTIVE_PROBES[i].path] = CAPTIVE_PROBES[i].reply == CAPTIVE_LANDING ? landing : std::string(head);
+    }
+    portal[CAPTIVE_LANDING_PATH] = landing;
+    return true;
+}
+
+void WsServer::answerDns() {
+    static const uint8_t LOOPBACK[4] = {127, 0, 0, 1};
+    uint8_t query[512], reply[512];
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n;
+    while ((n = recvfrom(dnsFd, query, sizeof(query), 0, (sockaddr*)&from, &fromLen)) > 0) {
+        size_t len = dnsReply(query, n, LOOPBACK, reply, sizeof(reply));
+        if (len) { sendto(dnsFd, reply, len, 0, (sockaddr*)&from, fromLen); dnsQueries++; }
+        fromLen = sizeof(from);
+    }
+}
+
+void WsServer::poll(int timeoutMs) {
+    std::vector<pollfd> fds;
+    std::vector<uint32_t> ids;
+    fds.push_back({listenFd, POLLIN, 0});
+    fds.push_back({dnsFd, POLLIN, 0});               // 負值 fd 由 poll() 略過
+    for (auto& cp : conns) {
+        fds.push_back({cp.second.fd, (short)(POLLIN | (cp.second.out.empty() ? 0 : POLLOUT)), 0});
+        ids.push_back(cp.first);
+    }
+    int ready = ::poll(fds.data(), fds.size(), std::min(timeoutMs, PING_MS));
+    auto now = std::chrono::steady_clock::now();
+
+    if (ready > 0 && (fds[0].revents & POLLIN)) {
+        int fd;
+        while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 小訊框不等待合併
+            conns[nextId++].fd = fd;
+        }
+    }
+    if (ready > 0 && (fds[1].revents & POLLIN)) answerDns();
+    for (size_t i = 2; i < fds.size(); i++) {
+        auto it = conns.find(ids[i - 2]);
+        if (it == conns.end()) continue;
+        Conn& c = it->second;
+        bool ok = true;
+        if (ready > 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+            char buf[4096];
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.lastRecv = now; c.pinged = false;
+                c.in.append(buf, n);
+                if (!c.upgraded) ok = handshake(c);
+                if (ok && c.upgraded && c.watch < 0) ok = readFrames(it->first, c);
+            } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                ok = false;
+            }
+        }
+        // 存活偵測：閒置送 ping，任何資料 (含 pong) 都算回應
+        bool ws = c.upgraded && c.watch < 0;
+        if (ok && ws && !c.closing) {
+            auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(now - c.lastRecv).count();
+            if (idle >= DEAD_MS) ok = false;
+            else if (idle >= PING_MS && !c.pinged) { queue(c, 0x9, "", 0); c.pinged = true; }
+        }
+        if (ok) ok = flush(c);
+        if (!ok || (c.closing && c.out.empty())) {
+            uint32_t id = it->first;
+            ::close(c.fd);
+            conns.erase(it);
+            if (ws && onClose) onClose(id);
+        }
+    }
+}
+
+bool WsServer::handshake(Conn& c) {
+    size_t end = c.in.find("\r\n\r\n");
+    if (end == std::string::npos) return c.in.size() < 8192;
+    std::string req = c.in.substr(0, end + 2);
+    c.in.erase(0, end + 4);
+
+    std::string key = header(req, "Sec-WebSocket-Key");
+    if (!key.empty()) {
+        key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t digest[20];
+        sha1((const uint8_t*)key.data(), key.size(), digest);
+        c.out += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+        c.out += base64(digest, sizeof(digest));
+        c.out += "\r\n\r\n";
+        c.upgraded = true;
+        connects++;
+        return true;
+    }
+    // 旁觀者頻道：Server-Sent Events，連線保持開啟，之後只由 broadcast() 寫入
+    int room = 0;
+    if (sscanf(req.c_str(), "GET /watch/%d ", &room) == 1 && room >= 1) {
+        c.out += "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                 "Access-Control-Allow-Origin: *\r\n\r\n";
+        c.upgraded = true;
+        c.watch = room - 1;
+        connects++;
+        if (onWatch) onWatch(c.watch);
+        return true;
+    }
+    // 強制門戶：偵測網址與引導頁 (不含 query)
+    size_t sp = req.find(' '), qs = req.find_first_of(" ?", sp + 1);
+    auto probe = (req.compare(0, 4, "GET ") == 0 && qs != std::string::npos) ? portal.find(req.substr(4, qs - 4)) : portal.end();
+    if (probe != portal.end()) {
+        c.out += probe->second;
+        c.closing = true;
+        probes++;
+        return true;
+    }
+    // 一般 HTTP：只提供遊戲網頁 (含 ?watch=N 旁觀模式)
+    std::string body;
+    bool index = req.compare(0, 6, "GET / ") == 0 || req.compare(0, 6, "GET /?") == 0;
+    FILE* f = index ? fopen(indexPath.c_str(), "rb") : nullptr;
+    if (f) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) body.append(buf, n);
+        fclose(f);
+    }
+    char head[160];
+    snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+             f ? "200 OK" : "404 Not Found", body.size());
+    c.out += head;
+    c.out += body;
+    c.closing = true;
+    return true;
+}
+
+bool WsServer::readFrames(uint32_t id, Conn& c) {
+    for (;;) {
+        const uint8_t* p = (const uint8_t*)c.in.data();
+        size_t avail = c.in.size();
+        if (avail < 2) return true;
+        int opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7F;
+        size_t pos = 2;
+        if (len == 126) {
+            if (avail < 4) return true;
+            len = (uint64_t)p[2] << 8 | p[3]; pos = 4;
+        } else if (len == 127) {
+            if (avail < 10) return true;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = len << 8 | p[2 + i];
+            pos = 10;
+        }
+        if (!masked || len > 65536) return false;   // 用戶端訊框必須遮罩；超大訊框視為錯誤
+        if (avail < pos + 4 + len) return true;
+        const uint8_t* mask = p + pos;
+        std::string payload(len, '\0');
+        for (size_t i = 0; i < len; i++) payload[i] = (char)(p[pos + 4 + i] ^ mask[i % 4]);
+        c.in.erase(0, pos + 4 + len);
+
+        if (opcode == 0x1 || opcode == 0x2) {
+            if (onMessage) onMessage(id, payload.data(), payload.size(), opcode == 0x2);
+        } else if (opcode == 0x8) {
+            queue(c, 0x8, payload.data(), std::min<size_t>(payload.size(), 2));
+            c.closing = true;
+            return true;
+        } else if (opcode == 0x9) {
+            queue(c, 0xA, payload.data(), payload.size());
+        }
+    }
+}
+
+void WsServer::sendFrame(uint32_t clientId, int opcode, const char* data, size_t len) {
+    auto it = conns.find(clientId);
+    if (it == conns.end() || !it->second.upgraded || it->second.closing || it->second.watch >= 0) return;
+    Conn& c = it->second;
+    if (c.out.size() + len > MAX_QUEUED) { c.dropped++; return; }
+    queue(c, opcode, data, len);
+    frames++; bytes += len;
+    flush(c);
+}
+
+void WsServer::queue(Conn& c, int opcode, const char* data, size_t len) {
+    char head[10];
+    size_t n = 0;
+    head[n++] = (char)(0x80 | opcode);
+    if (len < 126) {
+        head[n++] = (char)len;
+    } else if (len < 65536) {
+        head[n++] = 126; head[n++] = (char)(len >> 8); head[n++] = (char)len;
+    } else {
+        head[n++] = 127;
+        for (int i = 7; i >= 0; i--) head[n++] = (char)((uint64_t)len >> (8 * i));
+    }
+    c.out.append(head, n);
+    c.out.append(data, len);
+}
+
+bool WsServer::flush(Conn& c) {
+    while (!c.out.empty()) {
+        ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        c.out.erase(0, n);
+    }
+    return true;
+}
+
+bool WsServer::clientStats(uint32_t clientId, uint32_t& queued, uint32_t& dropped) {
+    auto it = conns.find(clientId);
+    if (it == conns.end()) return false;
+    queued = it->second.out.size();
+    dropped = it->second.dropped;
+    return true;
+}
+
+int WsServer::watchers(int channel) {
+    int n = 0;
+    for (auto& cp : conns) n += (cp.second.watch == channel && !cp.second.closing);
+    return n;
+}
+
+// SSE 事件：同一份內容附加到每個訂閱者的送出緩衝
+void WsServer::broadcast(int channel, const char* data, size_t len) {
+    std::string event = "data: ";
+    event.append(data, len);
+    event += "\n\n";
+    for (auto& cp : conns) {
+        Conn& c = cp.second;
+        if (c.watch != channel || c.closing) continue;
+        if (c.out.size() + event.size() > MAX_QUEUED) { c.dropped++; continue; }
+        c.out += event;
+        frames++; bytes += len;
+        flush(c);
+    }
+}
+
+bool WsServer::canSend(uint32_t clientId) {
+    auto it = conns.find(clientId);
+    return it != conns.end() && !it->second.closing && it->second.out.size() < DEFER_BYTES;
+}
+
+void WsServer::close(uint32_t clientId) {
+    auto it = conns.find(clientId);
+    if (it == conns.end() || it->second.closing) return;
+    if (it->second.upgraded) queue(it->second, 0x8, "\x03\xe8", 2); // 1000 正常關閉
+    it->second.closing = true;
+    flush(it->second);
+}
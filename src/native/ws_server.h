@@ -0,0 +1,75 @@
+/*
+ * =============================================================
+ * 開發機 WebSocket 伺服器 (program serve)
+ * -------------------------------------------------------------
+ * 以 POSIX socket + poll() 實作的最小 RFC 6455 伺服器，單執行緒：
+ *   - GET /ws 升級為 WebSocket，收到的文字/二進位訊框交給 onMessage
+ *   - GET / 回傳 web/index.html，可直接以瀏覽器在開發機上遊玩
+ *   - GET /watch/N 為第 N 桌的旁觀者頻道 (Server-Sent Events，與 ESP32 相同)
+ *   - 每個連線有送出緩衝上限，超過即丟棄訊框 (比照 ESP32 的 queueIsFull)；
+ *     待送超過 DEFER_BYTES 時 canSend() 回報 false，引擎延後並合併同步
+ *   - 閒置 PING_MS 送出 ping，DEAD_MS 內沒有任何回應即視為斷線 (比照 ESP32 keepAlive + RxTimeout)
+ *   - 強制門戶：各系統的偵測網址與引導頁回傳開機時組好的回應 (captive_portal.h)，
+ *     同埠號的 UDP 回答 DNS (一律指向 127.0.0.1)，供 loadgen --join 量測加入延遲
+ * 作為 Transport 實作，讓壓力測試工具 (tools/loadgen.py) 連線量測。
+ * =============================================================
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include "hal.h"
+
+class WsServer : public Transport {
+public:
+    static const size_t MAX_QUEUED = 256 * 1024;    // 單一連線待送位元組上限
+    static const size_t DEFER_BYTES = 16 * 1024;    // 超過即請引擎延後同步
+    static const int PING_MS = 5000;
+    static const int DEAD_MS = 15000;
+
+    ~WsServer();
+    bool listen(uint16_t port);
+    // 最多等待 timeoutMs：接受連線、完成握手、讀取訊框並呼叫 onMessage
+    void poll(int timeoutMs);
+
+    std::function<void(uint32_t, const char*, size_t, bool)> onMessage;
+    std::function<void(int)> onWatch;                // 旁觀者頻道有新訂閱者 (channel 0 起算)
+    std::function<void(uint32_t)> onClose;           // WebSocket 連線已關閉或逾時
+    std::string indexPath = "web/index.html";
+    unsigned long frames = 0, bytes = 0, connects = 0;
+    unsigned long dnsQueries = 0, probes = 0;
+
+    void text(uint32_t clientId, const char* data, size_t len) override { sendFrame(clientId, 0x1, data, len); }
+    void binary(uint32_t clientId, const uint8_t* data, size_t len) override { sendFrame(clientId, 0x2, (const char*)data, len); }
+    bool clientStats(uint32_t clientId, uint32_t& queued, uint32_t& dropped) override;
+    bool canSend(uint32_t clientId) override;
+    void close(uint32_t clientId) override;
+    int watchers(int channel) override;
+    void broadcast(int channel, const char* data, size_t len) override;
+
+private:
+    struct Conn {
+        int fd;
+        bool upgraded = false;
+        bool closing = false;            // 送完後關閉 (HTTP 回應或 close 訊框)
+        int watch = -1;                  // 旁觀者頻道 (-1 = 非 SSE 連線)
+        std::chrono::steady_clock::time_point lastRecv = std::chrono::steady_clock::now();
+        bool pinged = false;             // 閒置後已送出 ping，等待任何回應
+        std::string in, out;
+        uint32_t dropped = 0;
+    };
+    int listenFd = -1;
+    int dnsFd = -1;
+    std::map<std::string, std::string> portal;  // 路徑 -> 完整 HTTP 回應
+    uint32_t nextId = 1;
+    std::map<uint32_t, Conn> conns;
+
+    void sendFrame(uint32_t clientId, int opcode, const char* data, size_t len);
+    void queue(Conn& c, int opcode, const char* data, size_t len);
+    bool handshake(Conn& c);             // false = 請求尚未完整
+    bool readFrames(uint32_t id, Conn& c);
+    bool flush(Conn& c);                 // false = 連線錯誤
+    void answerDns();
+};
@@ -0,0 +1,64 @@
+#include "oled_renderer.h"
+#include "role_traits.h"
+
+void OledRenderer::publish(const OledView& v) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pending = v;
+    seq.store(s + 2, std::memory_order_release);
+    published++;
+}
+
+bool OledRenderer::render() {
+    unsigned long now = clock.millis();
+    if (hasShown && now - lastFrame < minFrameMs) return false;
+
+    OledView v;
+    uint32_t s0, s1;
+    do {
+        s0 = seq.load(std::memory_order_acquire);
+        v = pending;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s1 = seq.load(std::memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    if (s0 == 0 || (hasShown && v == shown)) return false; // 尚未發布或內容未變
+
+    // 全緩衝模式只跑一輪；頁緩衝模式逐頁重畫 (U8g2 firstPage/nextPage)
+    display.firstPage();
+    do { draw(v); } while (display.nextPage());
+    shown = v; hasShown = true; lastFrame = now;
+    frames++;
+    return true;
+}
+
+void OledRenderer::draw(const OledView& v) {
+    Display& u8g2 = display;
+    if (v.room) { u8g2.setCursor(104, 10); u8g2.print("T"); u8g2.print(v.room); } // 多桌：右上角桌號
+    if (v.screen == OledView::COUNTDOWN) {
+        u8g2.drawStr(0, 20, "READYING...");
+        u8g2.setCursor(60, 50); u8g2.print(v.countdown);
+    } else if (v.screen == OledView::GAME_OVER) {
+        u8g2.drawStr(0, 15, "GAME OVER!");
+        u8g2.setCursor(0, 35); u8g2.print("Win: "); u8g2.print(v.humansWon ? "HUMANS" : "WOLVES");
+        if (v.adminApproved) {
+            u8g2.drawStr(0, 55, "Ready: ");
+            u8g2.setCursor(70, 55); u8g2.print(v.readyCount);
+            u8g2.print("/"); u8g2.print(v.targetCount);
+        } else {
+            u8g2.drawStr(0, 55, "> PRESS SW <");
+        }
+    } else if (v.screen == OledView::WAITING) {
+        // V1.6: 區分設定人數與等待連線狀態 (OLED)
+        u8g2.drawStr(0, 20, "WAITING JOIN...");
+        u8g2.setCursor(30, 50); u8g2.print(v.currentCount);
+        u8g2.print(" / "); u8g2.print(v.targetCount);
+    } else if (v.screen == OledView::SETUP) {
+        u8g2.drawStr(0, 20, "SET PLAYER:"); u8g2.setCursor(70, 20); u8g2.print(v.targetCount);
+        u8g2.setCursor(0, 50); u8g2.print("Joined: "); u8g2.print(v.currentCount);
+    } else {
+        u8g2.setCursor(0, 15); u8g2.print("Day: "); u8g2.print(v.round);
+        const char* pName = (v.nightPhase >= 0 && v.nightPhase < PHASE_COUNT) ? PHASE_TRAITS[v.nightPhase].oled : "VOTING TIME";
+        u8g2.drawStr(0, 40, pName);
+    }
+}
@@ -0,0 +1,61 @@
+#include "player_table.h"
+
+// FNV-1a：先比對雜湊再比對字串
+static uint32_t hashId(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+int PlayerTable::find(const char* devId) const {
+    if (!devId || !*devId) return -1;
+    uint32_t h = hashId(devId);
+    for (int i = 0; i < count; i++) {
+        if (idHash[i] == h && strcmp(deviceId[i], devId) == 0) return i;
+    }
+    return -1;
+}
+
+int PlayerTable::intern(const char* devId) {
+    int seat = find(devId);
+    if (seat >= 0) return seat;
+    if (!devId || !*devId || strlen(devId) >= (size_t)ID_LEN || count >= CAPACITY) return -1;
+
+    seat = count++;
+    idHash[seat] = hashId(devId);
+    strcpy(deviceId[seat], devId);
+    role[seat] = ROLE_JOINED;
+    roleMask[ROLE_JOINED] |= bit(seat);
+    index[seat] = 0;
+    aliveMask |= bit(seat);
+    return seat;
+}
+
+void PlayerTable::release(Mask drop, int8_t* moved) {
+    int kept = 0;
+    for (int seat = 0; seat < count; seat++) {
+        if (drop & bit(seat)) { moved[seat] = -1; continue; }
+        moved[seat] = kept;
+        if (kept != seat) {
+            idHash[kept] = idHash[seat];
+            strcpy(deviceId[kept], deviceId[seat]);
+            role[kept] = role[seat];
+            index[kept] = index[seat];
+        }
+        kept++;
+    }
+    count = kept;
+    for (int r = 0; r < ROLE_COUNT; r++) roleMask[r] = 0;
+    for (int seat = 0; seat < count; seat++) roleMask[role[seat]] |= bit(seat);
+    aliveMask = remap(aliveMask, moved);
+    revealedMask = remap(revealedMask, moved);
+    votedMask = remap(votedMask, moved);
+}
+
+PlayerTable::Mask PlayerTable::remap(Mask m, const int8_t* moved) {
+    Mask out = 0;
+    for (int seat = 0; m; seat++, m >>= 1) {
+        if ((m & 1) && moved[seat] >= 0) out |= bit(moved[seat]);
+    }
+    return out;
+}
@@ -0,0 +1,64 @@
+#include "protocol.h"
+#include <string.h>
+#include <ArduinoJson.h>
+
+// 只列網頁可送出的動作；伺服器產生的動作沒有線上名稱，無法由 client 偽造
+static const char* const ACTION_NAMES[ACT_CLIENT_COUNT] = {
+    "", "connect", "resync", "restart", "guardProtect", "wolfKill", "seerCheck",
+    "witchHeal", "witchPoison", "witchSkip", "champExile", "hunterShoot"
+};
+
+const char* actionName(Action a) {
+    return (a < ACT_CLIENT_COUNT) ? ACTION_NAMES[a] : "";
+}
+
+Action actionFromName(const char* name) {
+    for (int i = 1; i < ACT_CLIENT_COUNT; i++) {
+        if (strcmp(name, ACTION_NAMES[i]) == 0) return (Action)i;
+    }
+    return ACT_NONE;
+}
+
+const WireName WIRE_KEYS[K_COUNT] = {
+    {"action", "a"}, {"deviceId", "d"}, {"targetId", "t"}, {"proto", "pr"}, {"room", "rm"},
+    {"type", "t"}, {"base", "b"}, {"v", "v"}, {"role", "r"}, {"index", "i"}, {"id", "id"},
+    {"isDead", "d"}, {"phase", "p"}, {"gameOver", "go"}, {"winner", "w"},
+    {"adminApproved", "aa"}, {"targets", "tg"}, {"isPhaseLocked", "pl"},
+    {"hunterActionPending", "hp"}, {"countdown", "cd"}, {"isStarting", "st"},
+    {"idiotRevealed", "ir"}, {"waitingForPlayers", "wp"}, {"currentCount", "cc"},
+    {"targetCount", "tc"}, {"votedPlayers", "vp"}, {"canShoot", "cs"},
+    {"deathNote", "dn"}, {"lastGuardedId", "lg"}, {"hasHeal", "hh"},
+    {"hasPoison", "hq"}, {"wolfTargetIndex", "wi"}, {"wolfTargetId", "wt"},
+    {"rooms", "rn"}, {"round", "rd"}, {"players", "ps"}, {"ballots", "bl"}, {"voters", "vn"}
+};
+
+const WireName MSG_TYPES[MSG_TYPE_COUNT] = {
+    {"update", "u"}, {"delta", "d"}, {"seat", "s"}, {"seerResult", "sr"}, {"watch", "wa"}, {"full", "fu"},
+    {"goWatch", "gw"}
+};
+
+static void copyId(char* dst, const char* src) {
+    if (strlen(src) < (size_t)PlayerTable::ID_LEN) strcpy(dst, src);
+    else dst[0] = '\0';
+}
+
+bool parseCommand(uint32_t clientId, const char* data, size_t len, bool binary, Command& out) {
+    StaticJsonDocument<256> doc;
+    if (binary) {
+        // MessagePack：短標籤，動作為整數代碼
+        if (deserializeMsgPack(doc, data, len)) return false;
+        int code = doc[wireKey(K_ACTION, true)] | 0;
+        out.action = (code > 0 && code < ACT_CLIENT_COUNT) ? (Action)code : ACT_NONE;
+    } else {
+        if (deserializeJson(doc, data, len)) return false;
+        out.action = actionFromName(doc[wireKey(K_ACTION, false)] | "");
+    }
+    out.clientId = clientId;
+    out.binary = binary;
+    out.wantsMsgPack = strcmp(doc[wireKey(K_PROTO, false)] | "", "mp") == 0;
+    copyId(out.deviceId, doc[wireKey(K_DEVICE_ID, binary)] | "");
+    copyId(out.targetId, doc[wireKey(K_TARGET_ID, binary)] | "");
+    int room = doc[wireKey(K_ROOM, binary)] | 0;
+    out.room = (room > 0 && room < 256) ? (uint8_t)room : 0;
+    return out.action != ACT_NONE; // 未知或伺服器專用的動作不進引擎，也不寫入行動紀錄
+}
@@ -0,0 +1,72 @@
+#include "role_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RolePool RolePool::standard() {
+    RolePool p;
+    const Step steps[] = {
+        {0, ROLE_WOLF}, {0, ROLE_WOLF}, {0, ROLE_SEER}, {0, ROLE_WITCH},
+        {7, ROLE_HUNTER}, {9, ROLE_WOLF}, {10, ROLE_GUARD}, {12, ROLE_WOLF}, {13, ROLE_IDIOT},
+    };
+    for (const Step& s : steps) p.steps[p.count++] = s;
+    p.prepare();
+    return p;
+}
+
+int RolePool::build(int players, Role* out, int cap) const {
+    int n = 0;
+    for (int i = 0; i < count && n < players && n < cap; i++) {
+        if (players >= steps[i].minPlayers) out[n++] = steps[i].role;
+    }
+    while (n < players && n < cap) out[n++] = ROLE_VILLAGER;
+    return n;
+}
+
+// 依人數預先展開，開局時直接複製，不再逐步比對門檻
+void RolePool::prepare() {
+    for (int n = MIN_PLAYERS; n <= MAX_PLAYERS; n++) build(n, deals[n], MAX_PLAYERS);
+}
+
+int RolePool::deal(int players, Role* out, int cap) const {
+    if (players < MIN_PLAYERS || players > MAX_PLAYERS || players > cap) return build(players, out, cap);
+    memcpy(out, deals[players], players * sizeof(Role));
+    return players;
+}
+
+bool RolePool::parse(const char* spec) {
+    count = 0;
+    const char* p = spec;
+    while (*p) {
+        if (count == MAX_STEPS) return false;
+        size_t len = strcspn(p, ",@");
+        Role role = ROLE_COUNT;
+        for (int r = ROLE_VILLAGER; r < ROLE_COUNT; r++) {
+            const char* key = ROLE_TRAITS[r].key;
+            if (*key && strlen(key) == len && strncmp(p, key, len) == 0) role = (Role)r;
+        }
+        if (role == ROLE_COUNT) return false;
+        p += len;
+        int minPlayers = 0;
+        if (*p == '@') {
+            char* end;
+            minPlayers = (int)strtol(p + 1, &end, 10);
+            if (end == p + 1 || minPlayers < 0 || minPlayers > PlayerTable::CAPACITY) return false;
+            p = end;
+        }
+        steps[count++] = {(uint8_t)minPlayers, role};
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    prepare();
+    return count > 0;
+}
+
+void RolePool::format(char* out, size_t len) const {
+    size_t n = 0;
+    out[0] = '\0';
+    for (int i = 0; i < count && n < len; i++) {
+        n += snprintf(out + n, len - n, steps[i].minPlayers ? "%s%s@%d" : "%s%s", i ? "," : "",
+                      ROLE_TRAITS[steps[i].role].key, steps[i].minPlayers);
+    }
+}
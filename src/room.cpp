@@ -0,0 +1,91 @@
+#include "room.h"
+#include <algorithm>
+
+// --- 共用喇叭 ---
+
+bool SharedSpeaker::ready(int ch) {
+    unsigned long now = clock.millis();
+    unsigned long held = now - startedAt;
+    askedAt[ch] = now;
+    bool free = owner < 0 || (held >= AudioQueue::SETTLE_MS && (!out.isBusy() || held >= HOLD_LIMIT_MS));
+    if (!free) { waiting |= 1u << ch; return false; }
+    // 輪流：從上一個播放的桌往後找，先輪到的等待中桌優先 (本桌連續兩段之間也會讓出)
+    for (int i = 1; i <= MAX_ROOMS; i++) {
+        int c = (std::max(owner, 0) + i) % MAX_ROOMS;
+        if (c == ch) break;
+        // 佇列已清空的桌不會再詢問，超過 STALE_MS 未詢問即不再等它
+        if ((waiting & (1u << c)) && now - askedAt[c] <= STALE_MS) { waiting |= 1u << ch; return false; }
+    }
+    waiting &= ~(1u << ch);
+    return true;
+}
+
+void SharedSpeaker::play(int ch, int fileID) {
+    owner = ch;
+    startedAt = clock.millis();
+    out.play(fileID);
+}
+
+// --- 多桌 ---
+
+RoomSet::Room::Room(RoomSet& set, int id)
+    : audio(set.speaker, id), input(set, id),
+      hal{audio, set.hal.display, set.hal.transport, input, set.hal.clock, set.hal.sys}, game(hal) {}
+
+RoomSet::RoomSet(Hal& hal, int count) : hal(hal), speaker(hal.audio, hal.clock) {
+    rooms = std::max(1, std::min(count, MAX_ROOMS));
+    for (int i = 0; i < rooms; i++) {
+        new (storage[i]) Room(*this, i);
+        if (rooms > 1) at(i).game.setRoom(i + 1, rooms);
+    }
+}
+
+RoomSet::~RoomSet() {
+    for (int i = 0; i < rooms; i++) at(i).~Room();
+}
+
+void RoomSet::begin() {
+    for (int i = 0; i < rooms; i++) at(i).game.begin();
+}
+
+void RoomSet::handleCommand(const Command& cmd) {
+    int want = (cmd.room >= 1 && cmd.room <= rooms) ? cmd.room - 1 : -1;
+    auto it = cmd.clientId ? clientRoom.find(cmd.clientId) : clientRoom.end();
+    int room = (it != clientRoom.end()) ? it->second : std::max(want, 0);
+    if (cmd.action == ACT_CONNECT && want >= 0 && want != room) {
+        WerewolfGame& from = at(room).game;
+        if (!(from.seatsLocked() && from.table().find(cmd.deviceId) >= 0)) {
+            // 換桌：原桌視同離線 (寫入行動紀錄)，大廳中的座位與人數一併讓出
+            Command leave;
+            leave.clientId = cmd.clientId;
+            leave.action = ACT_DISCONNECT;
+            from.handleCommand(leave);
+            room = want;
+        } // 原桌已開局且本裝置在座：拒絕換桌，connect 交給原桌 (重送快照與桌號)
+    }
+    if (cmd.clientId && cmd.action == ACT_CONNECT) clientRoom[cmd.clientId] = (uint8_t)room;
+    if (cmd.action == ACT_DISCONNECT && it != clientRoom.end()) clientRoom.erase(it);
+    at(room).game.handleCommand(cmd);
+}
+
+unsigned long RoomSet::loop() {
+    unsigned long wait = (unsigned long)-1;
+    for (int i = 0; i < rooms; i++) wait = std::min(wait, at(i).game.loop());
+    updateFocus();
+    return wait;
+}
+
+// 主控桌不再需要操作時，交給下一個需要主控的桌；都不需要則維持不變
+void RoomSet::updateFocus() {
+    int f = focus();
+    if (at(f).game.needsAdmin()) return;
+    for (int i = 0; i < rooms; i++) {
+        if (at(i).game.needsAdmin()) { focused.store(i, std::memory_order_relaxed); return; }
+    }
+}
+
+bool RoomSet::render() {
+    int f = focus();
+    if (f != shownFocus) { game(f).oled().invalidate(); shownFocus = f; } // 換桌後整個畫面重畫
+    return game(f).oled().render();
+}
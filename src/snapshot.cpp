@@ -0,0 +1,75 @@
+#include "snapshot.h"
+#include <stdio.h>
+
+static const uint8_t MAGIC[4] = {'W', 'W', 'S', 'N'};
+
+// CRC-32 (IEEE)，以 16 項的半位元組表計算，表只佔 64 bytes
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+    static const uint32_t TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = TABLE[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = TABLE[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+void SnapshotStore::begin(int room) {
+    for (int i = 0; i < 2; i++) snprintf(keys[i], sizeof(keys[i]), "game%d%c", room, 'a' + i);
+}
+
+size_t SnapshotStore::readSlot(int i, uint32_t& seqOut) {
+    size_t n = sys.loadBlob(keys[i], slot, sizeof(slot));
+    if (n < HEADER_LEN || memcmp(slot, MAGIC, 4) != 0) return 0;
+    size_t len = slot[8] | slot[9] << 8;
+    if (n != HEADER_LEN + len) return 0;            // 寫到一半
+    uint32_t want = slot[10] | slot[11] << 8 | slot[12] << 16 | (uint32_t)slot[13] << 24;
+    if (crc32(payload(), len, crc32(slot + 4, 6)) != want) return 0;
+    seqOut = slot[4] | slot[5] << 8 | slot[6] << 16 | (uint32_t)slot[7] << 24;
+    return len;
+}
+
+size_t SnapshotStore::load() {
+    uint32_t s[2] = {0, 0};
+    size_t len[2];
+    for (int i = 0; i < 2; i++) len[i] = readSlot(i, s[i]);
+    int best = -1;
+    for (int i = 0; i < 2; i++) {
+        if (len[i] && (best < 0 || (int32_t)(s[i] - s[best]) > 0)) best = i;
+    }
+    if (best < 0) return 0;
+    if (best == 0) readSlot(0, s[0]); // 緩衝目前是 1 號槽的內容
+    seq = s[best];
+    next = best ^ 1;                  // 下次覆寫較舊的一槽
+    lastLen = len[best];
+    lastCrc = crc32(payload(), lastLen);
+    return lastLen;
+}
+
+bool SnapshotStore::changed(size_t len) {
+    pendingCrc = crc32(payload(), len);
+    return !disabled && (len != lastLen || pendingCrc != lastCrc);
+}
+
+bool SnapshotStore::commit(size_t len) {
+    if (disabled || len > MAX_PAYLOAD) return false;
+    uint32_t s = seq + 1;
+    memcpy(slot, MAGIC, 4);
+    for (int i = 0; i < 4; i++) slot[4 + i] = (uint8_t)(s >> (8 * i));
+    slot[8] = (uint8_t)len; slot[9] = (uint8_t)(len >> 8);
+    uint32_t c = crc32(payload(), len, crc32(slot + 4, 6));
+    for (int i = 0; i < 4; i++) slot[10 + i] = (uint8_t)(c >> (8 * i));
+    if (!sys.saveBlob(keys[next], slot, HEADER_LEN + len)) {
+        disabled = true;
+        sys.log("Snapshot: write %s failed, snapshots disabled\n", keys[next]);
+        return false;
+    }
+    seq = s;
+    next ^= 1;
+    lastLen = len;
+    lastCrc = pendingCrc;
+    return true;
+}
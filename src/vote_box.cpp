@@ -0,0 +1,44 @@
+#include "vote_box.h"
+
+void VoteBox::begin(VoteKind k, Mask voters) {
+    open = true;
+    kind = k;
+    eligible = voters;
+    cast = 0;
+    memset(backers, 0, sizeof(backers));
+    memset(tally, 0, sizeof(tally));
+}
+
+bool VoteBox::vote(int voter, int target) {
+    if (!open || voter < 0) return false;
+    Mask me = PlayerTable::bit(voter);
+    if (!(eligible & me) || (cast & me)) return false;
+    int slot = (target >= 0 && target < PlayerTable::CAPACITY) ? target : ABSTAIN;
+    cast |= me;
+    backers[slot] |= me;
+    tally[slot]++;
+    return true;
+}
+
+VoteBox::Mask VoteBox::leaders() const {
+    Mask best = 0;
+    int top = 0;
+    for (int seat = 0; seat < PlayerTable::CAPACITY; seat++) {
+        if (tally[seat] == 0 || tally[seat] < top) continue;
+        if (tally[seat] > top) { top = tally[seat]; best = 0; }
+        best |= PlayerTable::bit(seat);
+    }
+    return top > abstentions() ? best : 0; // 棄票不少於最高票：視同多數棄票
+}
+
+int VoteBox::close(TieRule tie, uint32_t rnd) {
+    open = false;
+    Mask best = leaders();
+    int n = PlayerTable::popcount(best);
+    if (n == 0 || (n > 1 && tie == TIE_NO_ONE)) return -1;
+    int k = (n > 1) ? (int)(rnd % n) : 0;
+    for (int seat = 0; seat < PlayerTable::CAPACITY; seat++) {
+        if ((best & PlayerTable::bit(seat)) && k-- == 0) return seat;
+    }
+    return -1;
+}
@@ -0,0 +1,47 @@
+# =============================================================
+# 建置前處理：把 web/index.html 以 gzip 壓縮後產生 include/web_index.h
+# -------------------------------------------------------------
+# 內容雜湊作為 ETag；壓縮時固定 mtime=0，相同內容產生相同位元組。
+# 產生的標頭檔不進版控，只在網頁內容變動時重寫。
+# =============================================================
+import gzip
+import hashlib
+import os
+
+Import("env")
+
+SRC = os.path.join(env.subst("$PROJECT_DIR"), "web", "index.html")
+DST = os.path.join(env.subst("$PROJECT_INCLUDE_DIR"), "web_index.h")
+
+
+def embed():
+    with open(SRC, "rb") as f:
+        html = f.read()
+    gz = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = [
+        "// 由 tools/embed_web.py 自 web/index.html 產生，請勿手動修改",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+        '#define INDEX_HTML_ETAG "\\"%s\\""' % etag,
+        "const size_t INDEX_HTML_GZ_LEN = %d;   // 原始 %d bytes" % (len(gz), len(html)),
+        "const uint8_t INDEX_HTML_GZ[] PROGMEM = {",
+    ]
+    for i in range(0, len(gz), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in gz[i:i + 16]) + ",")
+    lines += ["};", ""]
+    out = "\n".join(lines)
+
+    old = None
+    if os.path.exists(DST):
+        with open(DST, "r", encoding="utf-8") as f:
+            old = f.read()
+    if old != out:
+        with open(DST, "w", encoding="utf-8") as f:
+            f.write(out)
+        print("embed_web: %d -> %d bytes, etag %s" % (len(html), len(gz), etag))
+
+
+embed()
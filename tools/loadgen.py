@@ -0,0 +1,503 @@
+#!/usr/bin/env python3
+# =============================================================
+# WebSocket 壓力測試：模擬 N 支手機連線並玩完整局
+# -------------------------------------------------------------
+# 與網頁相同的協定 (connect / guardProtect / wolfKill / seerCheck /
+# witch* / champExile / hunterShoot / restart)，合併 update 快照與
+# delta 差量，版本不連續時要求 resync。前 --players 支手機入座遊玩，
+# 其餘為旁觀者 (只接收)。--rooms K 時每桌各開 --clients 支手機 (connect 帶 "room")。
+# 超過每桌座位數 (--seats) 的手機、以及收到 full / goWatch 的手機，與網頁相同改訂閱
+# 旁觀者頻道 /watch/N (Server-Sent Events)，收到第一筆 watch 即算取得快照。
+#
+# 量測：動作送出到該手機收到下一個 update/delta 的延遲 (p50/p90/p99)、
+# 每秒訊框數與每支手機收到的位元組數。
+# --join 時每支手機先走一遍強制門戶 (輪流使用各系統的偵測網址，跟隨 302 到引導頁)
+# 再連線，量測從偵測開始到收到第一個 update 的加入延遲；--dns-port 另先送一筆 DNS 查詢。
+#
+# 目標：
+#   開發機  .pio/build/native/program serve 8080 15 20 [桌數]  (主控按鍵自動按下；DNS 在同埠號 UDP)
+#   實機    --host 192.168.4.1 --port 80 --dns-port 53  (續局需主控按鍵同意)
+#
+# 用法：python3 tools/loadgen.py [--clients 15] [--players 15] [--games 1] [--proto json|mp] [--rooms 1]
+#                                [--join] [--dns-port N] [--seats 32]
+# 只用標準函式庫；大量連線時延遲也包含本工具自身的處理時間。
+# 結束碼：有任何手機始終沒收到快照時為 1。
+# =============================================================
+import argparse
+import asyncio
+import base64
+import json
+import os
+import random
+import struct
+import sys
+import time
+
+# --- 協定表 (與 include/protocol.h、web/index.html 一致) ---
+TAGS = {"t": "type", "b": "base", "v": "v", "r": "role", "i": "index", "id": "id", "d": "isDead", "p": "phase",
+        "go": "gameOver", "w": "winner", "aa": "adminApproved", "tg": "targets", "pl": "isPhaseLocked",
+        "hp": "hunterActionPending", "cd": "countdown", "st": "isStarting", "ir": "idiotRevealed",
+        "wp": "waitingForPlayers", "cc": "currentCount", "tc": "targetCount", "vp": "votedPlayers",
+        "cs": "canShoot", "dn": "deathNote", "lg": "lastGuardedId", "hh": "hasHeal", "hq": "hasPoison",
+        "wi": "wolfTargetIndex", "wt": "wolfTargetId", "rm": "room", "rn": "rooms",
+        "rd": "round", "ps": "players", "bl": "ballots", "vn": "voters"}
+TYPES = {"u": "update", "d": "delta", "s": "seat", "sr": "seerResult", "wa": "watch", "fu": "full",
+         "gw": "goWatch"}
+ROLES = ["Joined", "旁觀者", "平民", "狼人", "預言家", "女巫", "獵人", "守衛", "白痴"]
+ACTIONS = ["", "connect", "resync", "restart", "guardProtect", "wolfKill", "seerCheck", "witchHeal",
+           "witchPoison", "witchSkip", "champExile", "hunterShoot"]
+# 各系統的連網偵測網址 (與 src/captive_portal.cpp 一致)
+PROBES = ["/generate_204", "/gen_204", "/hotspot-detect.html", "/library/test/success.html", "/connecttest.txt",
+          "/ncsi.txt", "/redirect", "/fwlink/", "/canonical.html", "/success.txt", "/kindle-wifi/wifistub.html"]
+
+
+# --- MessagePack (只實作協定用到的型別) ---
+def mp_encode(v):
+    if v is None:
+        return b"\xc0"
+    if v is True or v is False:
+        return b"\xc3" if v else b"\xc2"
+    if isinstance(v, int):
+        if 0 <= v < 128:
+            return bytes([v])
+        if -32 <= v < 0:
+            return struct.pack("b", v)
+        return b"\xd2" + struct.pack(">i", v)
+    if isinstance(v, str):
+        s = v.encode()
+        if len(s) < 32:
+            return bytes([0xA0 | len(s)]) + s
+        return b"\xd9" + bytes([len(s)]) + s
+    if isinstance(v, dict):
+        out = bytes([0x80 | len(v)])
+        for k, x in v.items():
+            out += mp_encode(k) + mp_encode(x)
+        return out
+    raise TypeError(type(v))
+
+
+def mp_decode(buf):
+    pos = 0
+
+    def take(n):
+        nonlocal pos
+        pos += n
+        return buf[pos - n:pos]
+
+    def rd():
+        b = take(1)[0]
+        if b < 0x80:
+            return b
+        if b >= 0xE0:
+            return b - 256
+        if 0x80 <= b <= 0x8F:
+            return {rd(): rd() for _ in range(b & 0x0F)}
+        if 0x90 <= b <= 0x9F:
+            return [rd() for _ in range(b & 0x0F)]
+        if 0xA0 <= b <= 0xBF:
+            return take(b & 0x1F).decode()
+        fmt = {0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q", 0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q",
+               0xCA: ">f", 0xCB: ">d"}
+        if b in fmt:
+            return struct.unpack(fmt[b], take(struct.calcsize(fmt[b])))[0]
+        if b in (0xD9, 0xDA, 0xDB):
+            n = struct.unpack({0xD9: ">B", 0xDA: ">H", 0xDB: ">I"}[b], take(1 << (b - 0xD9)))[0]
+            return take(n).decode()
+        if b in (0xDC, 0xDD):
+            n = struct.unpack(">H" if b == 0xDC else ">I", take(2 if b == 0xDC else 4))[0]
+            return [rd() for _ in range(n)]
+        if b in (0xDE, 0xDF):
+            n = struct.unpack(">H" if b == 0xDE else ">I", take(2 if b == 0xDE else 4))[0]
+            return {rd(): rd() for _ in range(n)}
+        return {0xC0: None, 0xC2: False, 0xC3: True}[b]
+
+    return rd()
+
+
+def expand(o):
+    """與網頁相同：把短標籤展開回 JSON 欄位名稱"""
+    r = {}
+    for k, v in o.items():
+        n = TAGS.get(k, k)
+        if n == "type":
+            v = TYPES.get(v, v)
+        elif n == "role":
+            v = ROLES[v] if isinstance(v, int) and 0 <= v < len(ROLES) else ""
+        elif n == "targets":
+            v = [expand(t) for t in v]
+        r[n] = v
+    return r
+
+
+# --- WebSocket 用戶端 (RFC 6455，用戶端訊框需遮罩) ---
+class WebSocket:
+    def __init__(self, reader, writer):
+        self.reader, self.writer = reader, writer
+
+    @classmethod
+    async def connect(cls, host, port, path):
+        reader, writer = await asyncio.open_connection(host, port)
+        key = base64.b64encode(os.urandom(16)).decode()
+        writer.write(("GET %s HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (path, host, port, key)).encode())
+        head = await reader.readuntil(b"\r\n\r\n")
+        if b" 101 " not in head.split(b"\r\n")[0]:
+            raise ConnectionError(head.split(b"\r\n")[0].decode(errors="replace"))
+        return cls(reader, writer)
+
+    def send(self, data, binary):
+        mask = os.urandom(4)
+        n = len(data)
+        head = bytes([0x82 if binary else 0x81])
+        if n < 126:
+            head += bytes([0x80 | n])
+        elif n < 65536:
+            head += bytes([0x80 | 126]) + struct.pack(">H", n)
+        else:
+            head += bytes([0x80 | 127]) + struct.pack(">Q", n)
+        self.writer.write(head + mask + bytes(b ^ mask[i % 4] for i, b in enumerate(data)))
+
+    async def recv(self):
+        """回傳 (opcode, payload)；連線關閉時回傳 (None, b"")"""
+        while True:
+            try:
+                b0, b1 = await self.reader.readexactly(2)
+                n = b1 & 0x7F
+                if n == 126:
+                    n = struct.unpack(">H", await self.reader.readexactly(2))[0]
+                elif n == 127:
+                    n = struct.unpack(">Q", await self.reader.readexactly(8))[0]
+                payload = await self.reader.readexactly(n)
+            except (asyncio.IncompleteReadError, ConnectionError):
+                return None, b""
+            op = b0 & 0x0F
+            if op == 0x9:
+                self.writer.write(b"\x8a\x80" + os.urandom(4))  # pong (空內容)
+                continue
+            if op == 0x8:
+                return None, b""
+            return op, payload
+
+    def close(self):
+        self.writer.close()
+
+
+# --- 旁觀者頻道 (Server-Sent Events，每筆事件為一行 "data: <JSON>") ---
+class EventStream:
+    def __init__(self, reader, writer):
+        self.reader, self.writer = reader, writer
+
+    @classmethod
+    async def connect(cls, host, port, path):
+        reader, writer = await asyncio.open_connection(host, port)
+        writer.write(("GET %s HTTP/1.1\r\nHost: %s:%d\r\nAccept: text/event-stream\r\n\r\n" % (path, host, port)).encode())
+        head = await reader.readuntil(b"\r\n\r\n")
+        if b" 200 " not in head.split(b"\r\n")[0]:
+            raise ConnectionError(head.split(b"\r\n")[0].decode(errors="replace"))
+        return cls(reader, writer)
+
+    async def recv(self):
+        """回傳一筆事件內容；連線關閉時回傳 None"""
+        while True:
+            try:
+                line = await self.reader.readline()
+            except ConnectionError:
+                return None
+            if not line:
+                return None
+            if line.startswith(b"data: "):
+                return line[6:].rstrip(b"\r\n")
+
+    def close(self):
+        self.writer.close()
+
+
+# --- 強制門戶 ---
+async def http_get(host, port, path):
+    """回傳 (狀態碼, 標頭 dict)；伺服器回應後即關閉連線"""
+    reader, writer = await asyncio.open_connection(host, port)
+    writer.write(("GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n" % (path, host)).encode())
+    head = (await reader.readuntil(b"\r\n\r\n")).decode(errors="replace").split("\r\n")
+    headers = dict(line.split(": ", 1) for line in head[1:] if ": " in line)
+    await reader.readexactly(int(headers.get("Content-Length", "0")))
+    writer.close()
+    return int(head[0].split()[1]), headers
+
+
+class DnsQuery(asyncio.DatagramProtocol):
+    def __init__(self, name):
+        self.name, self.answer = name, asyncio.get_running_loop().create_future()
+
+    def connection_made(self, transport):
+        qname = b"".join(bytes([len(p)]) + p.encode() for p in self.name.split(".")) + b"\0"
+        transport.sendto(struct.pack(">HHHHHH", random.randrange(65536), 0x0100, 1, 0, 0, 0) + qname + b"\0\1\0\1")
+
+    def datagram_received(self, data, addr):
+        if not self.answer.done():
+            self.answer.set_result(data)
+
+
+async def dns_lookup(host, port, name):
+    """回傳第一筆 A 紀錄 (a.b.c.d)；逾時 1 秒拋出 TimeoutError"""
+    transport, proto = await asyncio.get_running_loop().create_datagram_endpoint(
+        lambda: DnsQuery(name), remote_addr=(host, port))
+    try:
+        data = await asyncio.wait_for(proto.answer, 1.0)
+    finally:
+        transport.close()
+    if struct.unpack(">H", data[6:8])[0] == 0:
+        return ""
+    return ".".join(str(b) for b in data[-4:])
+
+
+def percentile(samples, p):
+    if not samples:
+        return 0.0
+    s = sorted(samples)
+    return s[min(len(s) - 1, int(len(s) * p / 100))]
+
+
+# --- 模擬手機：與網頁 render() / bench 機器人相同的判斷 ---
+class Phone:
+    def __init__(self, run, n, room, plays, watch):
+        self.run, self.room, self.plays, self.watch = run, room, plays, watch
+        self.device_id = "L%05d" % n
+        self.state = None
+        self.index = 0                  # 玩家號碼 (seat 私訊)
+        self.sent_at = None             # 等待回應的動作送出時間
+        self.frames = self.bytes = self.resyncs = self.actions = 0
+        self.ws = None
+        self.join_at = None             # --join：開始走強制門戶的時間
+
+    def send(self, action, target=""):
+        mp = self.run.args.proto == "mp"
+        if mp and action != "connect":   # connect 一律以 JSON 協商
+            data, binary = mp_encode({"a": ACTIONS.index(action), "t": target, "d": self.device_id}), True
+        else:
+            msg = {"action": action, "targetId": target, "deviceId": self.device_id}
+            if mp:
+                msg["proto"] = "mp"
+            if action == "connect" and self.run.args.rooms > 1:
+                msg["room"] = self.room
+            data, binary = json.dumps(msg, ensure_ascii=False).encode(), False
+        if action not in ("connect", "resync"):
+            self.actions += 1
+            if self.sent_at is None:
+                self.sent_at = time.perf_counter()
+        self.ws.send(data, binary)
+
+    def pick(self, exclude=""):
+        ids = [t.get("id", "") for t in self.state.get("targets", []) if t.get("id", "") != exclude]
+        return random.choice(ids) if ids else ""
+
+    def act(self):
+        d = self.state
+        if d.get("gameOver"):
+            if d.get("adminApproved") and self.device_id not in d.get("votedPlayers", []):
+                self.send("restart")
+            return
+        if d.get("isStarting") or d.get("waitingForPlayers"):
+            return
+        if d.get("isDead"):
+            if d.get("canShoot") and d.get("hunterActionPending"):
+                self.send("hunterShoot", self.pick())
+                return
+            if not d.get("idiotRevealed"):
+                return
+        if d.get("isPhaseLocked") or self.index in d.get("ballots", []):
+            return                      # 本輪已投票
+        role, phase = d.get("role", ""), d.get("phase", -1)
+        if phase == 4 and role == "守衛":
+            self.send("guardProtect", self.pick(d.get("lastGuardedId", "")))
+        elif phase == 0 and role == "狼人":
+            self.send("wolfKill", self.pick())
+        elif phase == 1 and role == "預言家":
+            self.send("seerCheck", self.pick(self.device_id))
+        elif phase == 2 and role == "女巫":
+            r = random.randrange(3)
+            if r == 0 and d.get("hasHeal") and d.get("wolfTargetIndex"):
+                self.send("witchHeal", d.get("wolfTargetId", ""))
+            elif r == 1 and d.get("hasPoison"):
+                self.send("witchPoison", self.pick())
+            else:
+                self.send("witchSkip")
+        elif phase == 3 and not d.get("idiotRevealed"):
+            self.send("champExile", "" if random.randrange(8) == 0 else self.pick())
+
+    def receive(self, op, payload):
+        self.frames += 1
+        self.bytes += len(payload)
+        self.run.frames += 1
+        msg = expand(mp_decode(payload)) if op == 0x2 else json.loads(payload)
+        kind = msg.get("type")
+        if kind == "seat":
+            self.index = msg.get("index", 0)
+        if kind in ("full", "goWatch"):
+            self.watch = True           # 與網頁相同：改為旁觀本桌
+            return
+        if kind not in ("update", "delta"):
+            return
+        if self.join_at is not None:
+            self.run.join.append((time.perf_counter() - self.join_at) * 1000)
+            self.join_at = None
+        if self.sent_at is not None:
+            self.run.latency.append((time.perf_counter() - self.sent_at) * 1000)
+            self.sent_at = None
+        if kind == "update":
+            self.state = msg
+        elif self.state is None or msg.get("base") != self.state.get("v"):
+            self.resyncs += 1
+            self.send("resync")
+            return
+        else:
+            self.state.update(msg)
+        self.run.observe(self)
+        if self.plays and not self.run.done.is_set():
+            self.act()
+
+    async def portal(self):
+        """模擬手機連上 softAP 後的流程：DNS -> 偵測網址 -> (302) 引導頁"""
+        args, run = self.run.args, self.run
+        probe = PROBES[int(self.device_id[1:]) % len(PROBES)]
+        self.join_at = time.perf_counter()
+        if args.dns_port:
+            try:
+                if not await dns_lookup(args.host, args.dns_port, "connectivitycheck.gstatic.com"):
+                    run.portal_errors += 1
+            except asyncio.TimeoutError:
+                run.portal_errors += 1
+            run.dns.append((time.perf_counter() - self.join_at) * 1000)
+        t = time.perf_counter()
+        status, headers = await http_get(args.host, args.port, probe)
+        if status == 302:
+            location = headers.get("Location", "/")
+            status, _ = await http_get(args.host, args.port, "/" + location.split("://", 1)[-1].split("/", 1)[-1])
+        if status != 200:
+            run.portal_errors += 1
+        run.probe.append((time.perf_counter() - t) * 1000)
+
+    async def main(self):
+        args = self.run.args
+        if args.join:
+            await self.portal()
+        if not self.watch:
+            self.ws = await WebSocket.connect(args.host, args.port, args.path)
+            self.send("connect")
+            while not self.watch:
+                op, payload = await self.ws.recv()
+                if op is None:
+                    return
+                self.receive(op, payload)
+            self.ws.close()
+        self.ws = await EventStream.connect(args.host, args.port, "/watch/%d" % self.room)
+        while True:
+            payload = await self.ws.recv()
+            if payload is None:
+                break
+            self.frames += 1
+            self.bytes += len(payload)
+            self.run.frames += 1
+            if self.join_at is not None:
+                self.run.join.append((time.perf_counter() - self.join_at) * 1000)
+                self.join_at = None
+            self.state = json.loads(payload)
+
+
+class Run:
+    def __init__(self, args):
+        self.args = args
+        self.latency = []
+        self.join, self.dns, self.probe = [], [], []
+        self.portal_errors = 0
+        self.frames = 0
+        self.games = [0] * args.rooms
+        self.over = [True] * args.rooms  # 連線時若已結束，不計入局數
+        self.done = asyncio.Event()
+
+    def observe(self, phone):
+        """以每桌第一支手機的狀態計算局數；每桌都達到 --games 才結束"""
+        r = phone.room - 1
+        if phone is not self.phones[r * self.args.clients]:
+            return
+        over = bool(phone.state.get("gameOver"))
+        if over and not self.over[r]:
+            self.games[r] += 1
+            print("room %d game %d: %s" % (phone.room, self.games[r], phone.state.get("winner")), flush=True)
+            if min(self.games) >= self.args.games:
+                self.done.set()
+        self.over[r] = over
+
+    async def main(self):
+        args = self.args
+        self.phones = [Phone(self, r * args.clients + n, r + 1, n < args.players, n >= args.seats)
+                       for r in range(args.rooms) for n in range(args.clients)]
+        tasks = []
+        for p in self.phones:
+            tasks.append(asyncio.ensure_future(p.main()))
+            await asyncio.sleep(args.stagger / 1000)
+        start = time.perf_counter()
+        try:
+            await asyncio.wait_for(self.done.wait(), args.timeout)
+        except asyncio.TimeoutError:
+            print("timeout after %d s" % args.timeout)
+        elapsed = time.perf_counter() - start
+        for p in self.phones:
+            if p.ws:
+                p.ws.close()
+        for t in tasks:
+            t.cancel()
+        return self.report(elapsed)
+
+    def report(self, elapsed):
+        phones = self.phones
+        silent = sum(1 for p in phones if p.state is None)
+        watching = sum(1 for p in phones if p.watch)
+        total_bytes = sum(p.bytes for p in phones)
+        print("rooms=%d clients=%d players=%d proto=%s games=%d time=%.1f s" %
+              (self.args.rooms, len(phones), self.args.players, self.args.proto, sum(self.games), elapsed))
+        def dist(name, samples):
+            print("%s: n=%d p50=%.1f p90=%.1f p99=%.1f max=%.1f" %
+                  (name, len(samples), percentile(samples, 50), percentile(samples, 90),
+                   percentile(samples, 99), max(samples) if samples else 0.0))
+        dist("latency ms (action -> update/delta)", self.latency)
+        if self.args.join:
+            if self.args.dns_port:
+                dist("dns ms", self.dns)
+            dist("portal ms (probe -> landing)", self.probe)
+            dist("join ms (probe -> first update)", self.join)
+            print("portal errors=%d" % self.portal_errors)
+        print("frames=%d (%.1f/s) bytes=%d per client: avg=%.0f max=%d" %
+              (self.frames, self.frames / elapsed if elapsed else 0, total_bytes,
+               total_bytes / len(phones), max(p.bytes for p in phones)))
+        print("actions=%d resyncs=%d watchers=%d clients without snapshot=%d" %
+              (sum(p.actions for p in phones), sum(p.resyncs for p in phones), watching, silent))
+        return silent
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Werewolf WebSocket load generator")
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--path", default="/ws")
+    ap.add_argument("--clients", type=int, default=15, help="連線數 (含旁觀者)")
+    ap.add_argument("--seats", type=int, default=32, help="每桌座位數 (PlayerTable 容量)；其餘手機直接訂閱旁觀者頻道")
+    ap.add_argument("--players", type=int, default=None, help="入座遊玩的手機數 (預設同 clients，最多 15)")
+    ap.add_argument("--games", type=int, default=1, help="每桌局數")
+    ap.add_argument("--rooms", type=int, default=1, help="桌數 (每桌 --clients 支手機)")
+    ap.add_argument("--proto", choices=("json", "mp"), default="json")
+    ap.add_argument("--stagger", type=float, default=5.0, help="每支手機連線間隔 (ms)")
+    ap.add_argument("--timeout", type=float, default=1800.0, help="最長執行秒數")
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--join", action="store_true", help="連線前先走強制門戶並量測加入延遲")
+    ap.add_argument("--dns-port", type=int, default=0, help="--join 時先送 DNS 查詢 (開發機同 --port，實機 53)")
+    args = ap.parse_args()
+    if args.players is None:
+        args.players = min(args.clients, 15)
+    args.players = min(args.players, args.clients)
+    random.seed(args.seed)
+    if asyncio.run(Run(args).main()):
+        sys.exit(1)                     # 有手機始終沒收到快照
+
+
+if __name__ == "__main__":
+    main()
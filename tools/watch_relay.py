@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# =============================================================
+# 旁觀者頻道轉播：一台機器訂閱控制板的 /watch/N，再轉送給任意人數
+# -------------------------------------------------------------
+# 控制板的 softAP 最多 15 個裝置；旁觀者改連到轉播機 (筆電/樹莓派，
+# 一邊連控制板 AP、一邊接現場網路或自己開熱點)，控制板只多一個連線。
+#   GET /?watch=N   控制板的網頁 (首次請求時向控制板取得並快取)
+#   GET /watch/N    第 N 桌的 Server-Sent Events，新訂閱者立即收到最近一筆
+#
+# 用法：python3 tools/watch_relay.py [--board 192.168.4.1:80] [--listen 0.0.0.0:8081]
+# 只用標準函式庫。上游斷線時每 2 秒重連。
+# =============================================================
+import argparse
+import asyncio
+
+
+class Channel:
+    """單一桌的上游訂閱與下游扇出"""
+
+    def __init__(self, relay, room):
+        self.relay, self.room = relay, room
+        self.last = None                 # 最近一筆事件 (含 "data: ...\n\n")
+        self.subscribers = set()
+        self.events = 0
+        asyncio.ensure_future(self.pump())
+
+    async def pump(self):
+        host, port = self.relay.board
+        while True:
+            try:
+                reader, writer = await asyncio.open_connection(host, port)
+                writer.write(("GET /watch/%d HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n"
+                              % (self.room, host)).encode())
+                await reader.readuntil(b"\r\n\r\n")
+                event = b""
+                while True:
+                    line = await reader.readline()
+                    if not line:
+                        break
+                    if line.strip():
+                        event += line
+                        continue
+                    if event.startswith(b"data:"):   # 空行 = 事件結束；忽略註解與重連設定
+                        self.publish(event + b"\n")
+                    event = b""
+                writer.close()
+            except (OSError, asyncio.IncompleteReadError):
+                pass
+            await asyncio.sleep(2)
+
+    def publish(self, event):
+        self.last = event
+        self.events += 1
+        for q in self.subscribers:
+            if q.qsize() < 64:           # 跟不上的旁觀者略過，下一筆即為完整畫面
+                q.put_nowait(event)
+
+
+class Relay:
+    def __init__(self, board):
+        host, _, port = board.partition(":")
+        self.board = (host, int(port or 80))
+        self.channels = {}
+        self.index = None
+
+    def channel(self, room):
+        if room not in self.channels:
+            self.channels[room] = Channel(self, room)
+        return self.channels[room]
+
+    async def fetch_index(self):
+        host, port = self.board
+        reader, writer = await asyncio.open_connection(host, port)
+        writer.write(("GET / HTTP/1.0\r\nHost: %s\r\n\r\n" % host).encode())
+        data = await reader.read()
+        writer.close()
+        return data                      # 原樣轉送 (含 gzip 標頭)
+
+    async def handle(self, reader, writer):
+        try:
+            head = await reader.readuntil(b"\r\n\r\n")
+            path = head.split(b" ")[1].decode()
+            if path.startswith("/watch/") and path[7:].isdigit():
+                await self.watch(int(path[7:]), writer)
+            elif path == "/" or path.startswith("/?"):
+                if self.index is None:
+                    self.index = await self.fetch_index()
+                writer.write(self.index)
+                await writer.drain()
+            else:
+                writer.write(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")
+        except (OSError, asyncio.IncompleteReadError, IndexError):
+            pass
+        writer.close()
+
+    async def watch(self, room, writer):
+        ch = self.channel(room)
+        q = asyncio.Queue()
+        writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                     b"Access-Control-Allow-Origin: *\r\n\r\n")
+        if ch.last:
+            writer.write(ch.last)
+        ch.subscribers.add(q)
+        try:
+            while True:
+                writer.write(await q.get())
+                await writer.drain()
+        finally:
+            ch.subscribers.discard(q)
+
+
+async def main():
+    ap = argparse.ArgumentParser(description="Werewolf spectator relay")
+    ap.add_argument("--board", default="192.168.4.1:80")
+    ap.add_argument("--listen", default="0.0.0.0:8081")
+    args = ap.parse_args()
+    relay = Relay(args.board)
+    host, _, port = args.listen.partition(":")
+    server = await asyncio.start_server(relay.handle, host, int(port))
+    print("relaying %s -> http://%s/?watch=1" % (args.board, args.listen), flush=True)
+    async with server:
+        while True:
+            await asyncio.sleep(30)
+            for room, ch in sorted(relay.channels.items()):
+                print("room %d: watchers=%d events=%d" % (room, len(ch.subscribers), ch.events), flush=True)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())